@@ -37,6 +37,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/module.h>
+#include <sys/sdt.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
 #include <sys/linker.h>
@@ -72,15 +73,21 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwn_debug.h>
 #include <dev/rtwn/if_rtwn_efuse.h>
 #include <dev/rtwn/if_rtwn_fw.h>
+#include <dev/rtwn/if_rtwn_ps.h>
+#include <dev/rtwn/if_rtwn_rc.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
 #include <dev/rtwn/if_rtwn_rx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
 #include <dev/rtwn/if_rtwn_task.h>
+#include <dev/rtwn/if_rtwn_trace.h>
+#include <dev/rtwn/if_rtwn_tsf.h>
 #include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/rtl8192c/r92c_reg.h>
 
 
 static void		rtwn_radiotap_attach(struct rtwn_softc *);
+static int		rtwn_sysctl_rssi_batch(SYSCTL_HANDLER_ARGS);
 static void		rtwn_vap_decrement_counters(struct rtwn_softc *,
 			    enum ieee80211_opmode, int);
 static void		rtwn_set_ic_opmode(struct rtwn_softc *);
@@ -131,6 +138,8 @@ static void		rtwn_scan_start(struct ieee80211com *);
 static void		rtwn_scan_curchan(struct ieee80211_scan_state *,
 			    unsigned long);
 static void		rtwn_scan_end(struct ieee80211com *);
+static void		rtwn_offchan_enter(struct rtwn_softc *);
+static void		rtwn_offchan_leave(struct rtwn_softc *);
 static void		rtwn_getradiocaps(struct ieee80211com *, int, int *,
 			    struct ieee80211_channel[]);
 static void		rtwn_update_chw(struct ieee80211com *);
@@ -148,6 +157,9 @@ static int		rtwn_set_macaddr(struct rtwn_softc *,
 			    const uint8_t *, int);
 static struct ieee80211_node *rtwn_node_alloc(struct ieee80211vap *,
 			    const uint8_t mac[IEEE80211_ADDR_LEN]);
+static void		rtwn_macid_init(struct rtwn_softc *);
+static int		rtwn_macid_alloc(struct rtwn_softc *);
+static void		rtwn_macid_release(struct rtwn_softc *, int);
 static void		rtwn_newassoc(struct ieee80211_node *, int);
 static void		rtwn_node_free(struct ieee80211_node *);
 static void		rtwn_init_beacon_reg(struct rtwn_softc *);
@@ -172,12 +184,17 @@ rtwn_attach(struct rtwn_softc *sc)
 	sc->cur_bcnq_id = RTWN_VAP_ID_INVALID;
 
 	RTWN_NT_LOCK_INIT(sc);
+	rtwn_trace_init(sc);
 	rtwn_cmdq_init(sc);
 #ifndef D4054
 	callout_init_mtx(&sc->sc_watchdog_to, &sc->sc_mtx, 0);
 #endif
 	callout_init(&sc->sc_calib_to, 0);
 	callout_init(&sc->sc_pwrmode_init, 0);
+	rtwn_ps_init(sc);
+#ifndef RTWN_WITHOUT_UCODE
+	rtwn_fw_h2c_init(sc);
+#endif
 	mbufq_init(&sc->sc_snd, ifqmaxlen);
 
 	RTWN_LOCK(sc);
@@ -201,6 +218,7 @@ rtwn_attach(struct rtwn_softc *sc)
 		    sc->macid_limit, RTWN_MACID_LIMIT);
 		sc->macid_limit = RTWN_MACID_LIMIT;
 	}
+	rtwn_macid_init(sc);
 	if (sc->cam_entry_limit > RTWN_CAM_ENTRY_LIMIT) {
 		device_printf(sc->sc_dev,
 		    "cam entry limit will be reduced from %d to %d\n",
@@ -234,9 +252,7 @@ rtwn_attach(struct rtwn_softc *sc)
 #endif
 		| IEEE80211_C_SHPREAMBLE	/* short preamble supported */
 		| IEEE80211_C_SHSLOT		/* short slot time supported */
-#if 0
 		| IEEE80211_C_BGSCAN		/* capable of bg scanning */
-#endif
 		| IEEE80211_C_WPA		/* 802.11i */
 		| IEEE80211_C_WME		/* 802.11e */
 		| IEEE80211_C_SWAMSDUTX		/* Do software A-MSDU TX */
@@ -328,6 +344,27 @@ rtwn_radiotap_attach(struct rtwn_softc *sc)
 	    &rxtap->wr_ihdr, sizeof(*rxtap), RTWN_RX_RADIOTAP_PRESENT);
 }
 
+static int
+rtwn_sysctl_rssi_batch(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	int error, val;
+
+	val = sc->sc_rssi_batch;
+	error = sysctl_handle_int(oidp, &val, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+
+	/*
+	 * At least one report per round is required; macid_limit is
+	 * not known yet when the tunable is fetched, so the upper bound
+	 * is applied in r92c_set_rssi().
+	 */
+	sc->sc_rssi_batch = MAX(val, 1);
+
+	return (0);
+}
+
 void
 rtwn_sysctlattach(struct rtwn_softc *sc)
 {
@@ -359,7 +396,8 @@ rtwn_sysctlattach(struct rtwn_softc *sc)
 	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
 	    "ratectl", CTLFLAG_RDTUN, &sc->sc_ratectl_sysctl,
 	    sc->sc_ratectl_sysctl, "Select rate control mechanism: "
-	    "0 - disabled, 1 - via net80211, 2 - via firmware");
+	    "0 - disabled, 1 - via net80211, 2 - via firmware, "
+	    "3 - by the driver");
 	if (sc->sc_ratectl_sysctl >= RTWN_RATECTL_MAX)
 		sc->sc_ratectl_sysctl = RTWN_RATECTL_FW;
 
@@ -368,6 +406,89 @@ rtwn_sysctlattach(struct rtwn_softc *sc)
 	    "ratectl_selected", CTLFLAG_RD, &sc->sc_ratectl,
 	    sc->sc_ratectl,
 	    "Currently selected rate control mechanism (by the driver)");
+
+	sc->sc_rssi_delta = RTWN_RSSI_DELTA_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rssi_delta", CTLFLAG_RWTUN, &sc->sc_rssi_delta,
+	    sc->sc_rssi_delta, "Minimal RSSI (PWDB) change to be "
+	    "reported to firmware");
+	sc->sc_rssi_batch = RTWN_RSSI_BATCH_DEF;
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rssi_batch", CTLTYPE_INT | CTLFLAG_RWTUN | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_sysctl_rssi_batch, "I", "Maximal number of RSSI reports "
+	    "per calibration round (>= 1, bounded by the MACID limit)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rssi_sent", CTLFLAG_RD, &sc->sc_rssi_sent, 0,
+	    "Number of RSSI reports sent to firmware");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rssi_skipped", CTLFLAG_RD, &sc->sc_rssi_skipped, 0,
+	    "Number of RSSI reports skipped (no significant change)");
+
+	sc->sc_txrpt_max = RTWN_TXRPT_MAX_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "txrpt_max", CTLFLAG_RWTUN, &sc->sc_txrpt_max,
+	    sc->sc_txrpt_max, "Maximal Tx report sampling interval "
+	    "(1 - report every frame)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "txrpt_requested", CTLFLAG_RD, &sc->sc_txrpt_requested, 0,
+	    "Number of Tx reports requested");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "txrpt_skipped", CTLFLAG_RD, &sc->sc_txrpt_skipped, 0,
+	    "Number of Tx reports saved by sampling");
+
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "bcn_upd_requested", CTLFLAG_RD, &sc->sc_bcn_upd_requested, 0,
+	    "Number of beacon updates requested");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "bcn_upd_merged", CTLFLAG_RD, &sc->sc_bcn_upd_merged, 0,
+	    "Number of beacon updates merged with a pending one");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "bcn_upd_pushed", CTLFLAG_RD, &sc->sc_bcn_upd_pushed, 0,
+	    "Number of beacons pushed into the chip after an update");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "bcn_upd_unchanged", CTLFLAG_RD, &sc->sc_bcn_upd_unchanged, 0,
+	    "Number of beacon updates which did not change the frame");
+
+#ifndef D4054
+	sc->sc_tx_stall_ms = RTWN_TX_STALL_MS_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "tx_stall_ms", CTLFLAG_RWTUN, &sc->sc_tx_stall_ms,
+	    sc->sc_tx_stall_ms, "Time (in ms) without Tx completions after "
+	    "which a single queue is reset (0 - restart the device instead)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "tx_queue_resets", CTLFLAG_RD, &sc->sc_tx_queue_resets, 0,
+	    "Number of stuck Tx queues reset by the watchdog");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "tx_restarts", CTLFLAG_RD, &sc->sc_tx_restarts, 0,
+	    "Number of device restarts done by the watchdog");
+#endif
+
+	sc->sc_bgscan_idle = RTWN_BGSCAN_IDLE_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "bgscan_idle", CTLFLAG_RWTUN, &sc->sc_bgscan_idle,
+	    sc->sc_bgscan_idle, "Idle time (in ms) required before "
+	    "background scan for new STA vaps (0 - net80211 default)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "offchan_count", CTLFLAG_RD, &sc->sc_offchan_count, 0,
+	    "Number of times the home channel was left for scanning");
+	SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "offchan_us", CTLFLAG_RD, &sc->sc_offchan_us, 0,
+	    "Total time spent off the home channel (us)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "offchan_max_us", CTLFLAG_RD, &sc->sc_offchan_max_us, 0,
+	    "Longest continuous time off the home channel (us)");
+
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "macid_exhausted", CTLFLAG_RD, &sc->macid_exhausted, 0,
+	    "Number of times the MACID table was full");
+
+	rtwn_stats_sysctlattach(sc);
+	rtwn_cam_sysctlattach(sc);
+	rtwn_trace_sysctlattach(sc);
+	rtwn_ps_sysctlattach(sc);
+#ifndef RTWN_WITHOUT_UCODE
+	rtwn_fw_sysctlattach(sc);
+#endif
 }
 
 void
@@ -383,9 +504,14 @@ rtwn_detach(struct rtwn_softc *sc)
 
 		ieee80211_draintask(ic, &sc->cmdq_task);
 		ieee80211_ifdetach(ic);
+		rtwn_ps_detach(sc);
+#ifndef RTWN_WITHOUT_UCODE
+		rtwn_fw_h2c_drain(sc);
+#endif
 	}
 
 	rtwn_cmdq_destroy(sc);
+	rtwn_trace_detach(sc);
 	if (RTWN_NT_LOCK_INITIALIZED(sc))
 		RTWN_NT_LOCK_DESTROY(sc);
 }
@@ -574,7 +700,11 @@ rtwn_vap_create(struct ieee80211com *ic, const char name[IFNAMSIZ], int unit,
 	vap->iv_key_alloc = rtwn_key_alloc;
 	vap->iv_key_set = rtwn_key_set;
 	vap->iv_key_delete = rtwn_key_delete;
-	vap->iv_max_aid = sc->macid_limit;
+	/* Stations beyond the MACID table will share the broadcast one. */
+	vap->iv_max_aid = MAX(sc->macid_limit, IEEE80211_AID_DEF);
+	/* Background scan slots themselves are scheduled by net80211. */
+	if (opmode == IEEE80211_M_STA && sc->sc_bgscan_idle > 0)
+		vap->iv_bgscanidle = msecs_to_ticks(sc->sc_bgscan_idle);
 
 	/* 802.11n parameters */
 	vap->iv_ampdu_density = IEEE80211_HTCAP_MPDUDENSITY_16;
@@ -582,6 +712,8 @@ rtwn_vap_create(struct ieee80211com *ic, const char name[IFNAMSIZ], int unit,
 
 	TIMEOUT_TASK_INIT(taskqueue_thread, &uvp->tx_beacon_csa, 0,
 	    rtwn_tx_beacon_csa, vap);
+	TIMEOUT_TASK_INIT(taskqueue_thread, &uvp->bcn_upd_task, 0,
+	    rtwn_update_beacon_task, vap);
 	if (opmode == IEEE80211_M_IBSS) {
 		uvp->recv_mgmt = vap->iv_recv_mgmt;
 		vap->iv_recv_mgmt = rtwn_adhoc_recv_mgmt;
@@ -628,12 +760,15 @@ rtwn_vap_delete(struct ieee80211vap *vap)
 	ieee80211_stop(vap);
 	ieee80211_draintask(ic, &vap->iv_nstate_task);
 	ieee80211_draintask(ic, &ic->ic_parent_task);
+	taskqueue_drain_timeout(taskqueue_thread, &uvp->bcn_upd_task);
 
 	RTWN_LOCK(sc);
 	/* Cancel any unfinished Tx. */
 	rtwn_reset_lists(sc, vap);
 	if (uvp->bcn_mbuf != NULL)
 		m_freem(uvp->bcn_mbuf);
+	if (uvp->bcn_last != NULL)
+		free(uvp->bcn_last, M_DEVBUF);
 	rtwn_vap_decrement_counters(sc, vap->iv_opmode, uvp->id);
 	rtwn_set_ic_opmode(sc);
 	if (sc->sc_flags & RTWN_RUNNING)
@@ -831,6 +966,7 @@ rtwn_push_nulldata(struct rtwn_softc *sc, struct ieee80211vap *vap)
 
 	m->m_pkthdr.len = m->m_len = required_size - sc->txdesc_len;
 	uvp->bcn_mbuf = m;
+	uvp->bcn_last_len = 0;
 
 	error = rtwn_tx_beacon_check(sc, uvp);
 	if (error != 0) {
@@ -879,8 +1015,10 @@ rtwn_set_pwrmode_cb(struct rtwn_softc *sc, union sec_param *data)
 {
 	struct ieee80211vap *vap = &sc->vaps[0]->vap;
 
-	if (vap != NULL)
+	if (vap != NULL) {
+		rtwn_ps_start(sc);
 		rtwn_set_pwrmode(sc, vap, 1);
+	}
 }
 #endif
 
@@ -934,6 +1072,7 @@ rtwn_tsf_sync_adhoc_task(void *arg, int pending)
 	/* Disable synchronization. */
 	rtwn_setbits_1(sc, R92C_BCN_CTRL(uvp->id),
 	    0, R92C_BCN_CTRL_DIS_TSF_UDT0);
+	rtwn_tsf_est_reset(sc, uvp->id);
 
 	/* Accept all beacons. */
 	sc->sc_flags &= ~RTWN_RCR_LOCKED;
@@ -954,6 +1093,7 @@ rtwn_tsf_sync_enable(struct rtwn_softc *sc, struct ieee80211vap *vap)
 
 	/* Reset TSF. */
 	rtwn_write_1(sc, R92C_DUAL_TSF_RST, R92C_DUAL_TSF_RESET(uvp->id));
+	rtwn_tsf_est_reset(sc, uvp->id);
 
 	switch (vap->iv_opmode) {
 	case IEEE80211_M_STA:
@@ -1109,12 +1249,14 @@ rtwn_newstate(struct ieee80211vap *vap, enum ieee80211_state nstate, int arg)
 			/* Reset TSF. */
 			rtwn_write_1(sc, R92C_DUAL_TSF_RST,
 			    R92C_DUAL_TSF_RESET(uvp->id));
+			rtwn_tsf_est_reset(sc, uvp->id);
 		}
 
 #ifndef RTWN_WITHOUT_UCODE
 		if ((ic->ic_caps & IEEE80211_C_PMGT) != 0 && uvp->id == 0) {
 			/* Disable power management. */
 			callout_stop(&sc->sc_pwrmode_init);
+			rtwn_ps_stop(sc);
 			rtwn_set_pwrmode(sc, vap, 0);
 		}
 #endif
@@ -1350,13 +1492,35 @@ rtwn_watchdog(void *arg)
 {
 	struct rtwn_softc *sc = arg;
 	struct ieee80211com *ic = &sc->sc_ic;
+	int nreset;
 
 	RTWN_ASSERT_LOCKED(sc);
 
 	KASSERT(sc->sc_flags & RTWN_RUNNING, ("not running"));
 
-	if (sc->sc_tx_timer != 0 && --sc->sc_tx_timer == 0) {
+	/*
+	 * Reset stuck queues first; restart the whole device only
+	 * when that does not help.
+	 */
+	nreset = 0;
+	if (sc->sc_tx_timer != 0 && sc->sc_tx_stall_ms > 0 &&
+	    !sc->sc_offchan) {
+		nreset = rtwn_tx_recover(sc,
+		    MAX(msecs_to_ticks(sc->sc_tx_stall_ms), 1));
+		if (nreset > 0) {
+			ic_printf(ic, "Tx stall, %d queue(s) reset\n", nreset);
+			sc->sc_tx_queue_resets += nreset;
+			if (sc->sc_tx_timer != 0)
+				sc->sc_tx_timer = 5;
+			rtwn_start(sc);
+		}
+	}
+
+	/* The timer is frozen while data queues are paused. */
+	if (nreset < 0 || (sc->sc_tx_timer != 0 && !sc->sc_offchan &&
+	    --sc->sc_tx_timer == 0)) {
 		ic_printf(ic, "device timeout\n");
+		sc->sc_tx_restarts++;
 		ieee80211_restart_all(ic);
 		return;
 	}
@@ -1569,9 +1733,62 @@ rtwn_scan_end(struct ieee80211com *ic)
 
 	/* Resume beaconing. */
 	rtwn_setbits_1(sc, R92C_TXPAUSE, R92C_TX_QUEUE_BCN, 0);
+
+	/* In case the scan was cancelled off the home channel. */
+	rtwn_offchan_leave(sc);
 	RTWN_UNLOCK(sc);
 }
 
+/*
+ * Data frames are kept in the AC queues (and in sc_snd) while
+ * a background scan is off the home channel; management frames
+ * (probe requests) use the MGT queue, which is not paused.
+ * NB: net80211 tells the AP about power save mode by itself.
+ */
+static void
+rtwn_offchan_enter(struct rtwn_softc *sc)
+{
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (sc->sc_offchan)
+		return;
+
+	rtwn_setbits_1(sc, R92C_TXPAUSE, 0, R92C_TX_QUEUE_AC);
+	sc->sc_offchan = 1;
+	sc->sc_offchan_start = sbinuptime();
+	sc->sc_offchan_count++;
+}
+
+static void
+rtwn_offchan_leave(struct rtwn_softc *sc)
+{
+	uint32_t us;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (!sc->sc_offchan)
+		return;
+
+	us = (sbinuptime() - sc->sc_offchan_start) / SBT_1US;
+	sc->sc_offchan = 0;
+	sc->sc_offchan_us += us;
+	if (us > sc->sc_offchan_max_us)
+		sc->sc_offchan_max_us = us;
+
+	RTWN_DPRINTF(sc, RTWN_DEBUG_STATE,
+	    "%s: back on the home channel after %u us\n", __func__, us);
+
+	rtwn_setbits_1(sc, R92C_TXPAUSE, R92C_TX_QUEUE_AC, 0);
+#ifndef D4054
+	/* Frames were held on purpose; restart the Tx timeout. */
+	if (sc->sc_tx_timer != 0)
+		sc->sc_tx_timer = 5;
+#endif
+	if (sc->sc_flags & RTWN_RUNNING)
+		rtwn_start(sc);
+}
+
 static void
 rtwn_getradiocaps(struct ieee80211com *ic,
     int maxchans, int *nchans, struct ieee80211_channel chans[])
@@ -1611,9 +1828,22 @@ rtwn_set_channel(struct ieee80211com *ic)
 {
 	struct rtwn_softc *sc = ic->ic_softc;
 	struct ieee80211_channel *c = ic->ic_curchan;
+	struct ieee80211_channel *home = ic->ic_bsschan;
+	int offchan, tag;
+
+	/* Foreground scans do not return to the home channel. */
+	offchan = (ic->ic_flags & IEEE80211_F_SCAN) &&
+	    (ic->ic_flags_ext & IEEE80211_FEXT_BGSCAN) &&
+	    home != IEEE80211_CHAN_ANYC && c->ic_freq != home->ic_freq;
 
 	RTWN_LOCK(sc);
+	if (offchan)
+		rtwn_offchan_enter(sc);
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_CHAN, tag);
 	rtwn_set_chan(sc, c);
+	RTWN_REGACCT_RESTORE(sc, tag);
+	if (!offchan)
+		rtwn_offchan_leave(sc);
 	sc->sc_rxtap.wr_chan_freq = htole16(c->ic_freq);
 	sc->sc_rxtap.wr_chan_flags = htole16(c->ic_flags);
 	sc->sc_txtap.wt_chan_freq = htole16(c->ic_freq);
@@ -1763,10 +1993,74 @@ rtwn_node_alloc(struct ieee80211vap *vap,
 
 	un->id = RTWN_MACID_UNDEFINED;
 	un->avg_pwdb = -1;
+	un->rpt_pwdb = -1;
 
 	return &un->ni;
 }
 
+static void
+rtwn_macid_init(struct rtwn_softc *sc)
+{
+	int id;
+
+	memset(sc->macid_free, 0, sizeof(sc->macid_free));
+	memset(sc->macid_grace, 0, sizeof(sc->macid_grace));
+	for (id = 0; id < sc->macid_limit; id++) {
+		if (id != RTWN_MACID_BC)
+			sc->macid_free[id / 32] |= 1U << (id % 32);
+	}
+}
+
+static int
+rtwn_macid_alloc(struct rtwn_softc *sc)
+{
+	uint32_t bit;
+	int i, id;
+
+	RTWN_NT_LOCK_ASSERT(sc);
+
+	for (i = 0; i < nitems(sc->macid_free); i++) {
+		if (sc->macid_free[i] != 0)
+			goto found;
+	}
+
+	/* Reclaim MACIDs whose grace period has expired. */
+	for (id = 0; id < sc->macid_limit; id++) {
+		bit = 1U << (id % 32);
+		if ((sc->macid_grace[id / 32] & bit) != 0 &&
+		    ticks - sc->macid_freed_at[id] >= RTWN_MACID_GRACE) {
+			sc->macid_grace[id / 32] &= ~bit;
+			sc->macid_free[id / 32] |= bit;
+		}
+	}
+	for (i = 0; i < nitems(sc->macid_free); i++) {
+		if (sc->macid_free[i] != 0)
+			goto found;
+	}
+
+	return (RTWN_MACID_UNDEFINED);
+
+found:
+	id = ffs(sc->macid_free[i]) - 1;
+	sc->macid_free[i] &= ~(1U << id);
+
+	return (i * 32 + id);
+}
+
+static void
+rtwn_macid_release(struct rtwn_softc *sc, int id)
+{
+
+	RTWN_NT_LOCK_ASSERT(sc);
+
+	/*
+	 * Do not hand this MACID out again until pending Tx reports
+	 * and the media status update for it were processed.
+	 */
+	sc->macid_freed_at[id] = ticks;
+	sc->macid_grace[id / 32] |= 1U << (id % 32);
+}
+
 static void
 rtwn_newassoc(struct ieee80211_node *ni, int isnew)
 {
@@ -1774,22 +2068,25 @@ rtwn_newassoc(struct ieee80211_node *ni, int isnew)
 	struct rtwn_node *un = RTWN_NODE(ni);
 	int id;
 
+	/* Rate set may change on reassociation. */
+	rtwn_rc_reset(un);
+
 	if (!isnew)
 		return;
 
 	RTWN_NT_LOCK(sc);
-	for (id = 0; id <= sc->macid_limit; id++) {
-		if (id != RTWN_MACID_BC && sc->node_list[id] == NULL) {
-			un->id = id;
-			sc->node_list[id] = ni;
-			break;
-		}
-	}
+	id = rtwn_macid_alloc(sc);
+	if (id != RTWN_MACID_UNDEFINED) {
+		un->id = id;
+		sc->node_list[id] = ni;
+	} else
+		sc->macid_exhausted++;
 	RTWN_NT_UNLOCK(sc);
 
-	if (id > sc->macid_limit) {
-		device_printf(sc->sc_dev, "%s: node table is full\n",
-		    __func__);
+	if (id == RTWN_MACID_UNDEFINED) {
+		RTWN_DPRINTF(sc, RTWN_DEBUG_STATE,
+		    "%s: node table is full, %6D will share MACID %d\n",
+		    __func__, ni->ni_macaddr, ":", RTWN_MACID_BC);
 		return;
 	}
 
@@ -1809,6 +2106,7 @@ rtwn_node_free(struct ieee80211_node *ni)
 	RTWN_NT_LOCK(sc);
 	if (un->id != RTWN_MACID_UNDEFINED) {
 		sc->node_list[un->id] = NULL;
+		rtwn_macid_release(sc, un->id);
 #ifndef RTWN_WITHOUT_UCODE
 		rtwn_cmd_sleepable(sc, &un->id, sizeof(un->id),
 		    rtwn_set_media_status);
@@ -1834,7 +2132,13 @@ static int
 rtwn_init(struct rtwn_softc *sc)
 {
 	struct ieee80211com *ic = &sc->sc_ic;
-	int i, error;
+	int i, error, tag;
+#ifndef RTWN_WITHOUT_UCODE
+	int fwtag;
+#endif
+
+	/* Apply new ring sizes (may sleep). */
+	rtwn_resize_lists(sc);
 
 	RTWN_LOCK(sc);
 	if (sc->sc_flags & RTWN_RUNNING) {
@@ -1842,6 +2146,7 @@ rtwn_init(struct rtwn_softc *sc)
 		return (0);
 	}
 	sc->sc_flags |= RTWN_STARTED;
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_INIT, tag);
 
 	/* Power on adapter. */
 	error = rtwn_power_on(sc);
@@ -1850,12 +2155,14 @@ rtwn_init(struct rtwn_softc *sc)
 
 #ifndef RTWN_WITHOUT_UCODE
 	/* Load 8051 microcode. */
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_FW, fwtag);
 	error = rtwn_load_firmware(sc);
+	RTWN_REGACCT_RESTORE(sc, fwtag);
 	if (error == 0)
 		sc->sc_flags |= RTWN_FW_LOADED;
 
 	/* Init firmware commands ring. */
-	sc->fwcur = 0;
+	rtwn_fw_h2c_reset(sc);
 #endif
 
 	/* Initialize MAC block. */
@@ -1975,6 +2282,7 @@ rtwn_init(struct rtwn_softc *sc)
 
 	sc->sc_flags |= RTWN_RUNNING;
 fail:
+	RTWN_REGACCT_RESTORE(sc, tag);
 	RTWN_UNLOCK(sc);
 
 	return (error);
@@ -1983,6 +2291,7 @@ fail:
 static void
 rtwn_stop(struct rtwn_softc *sc)
 {
+	int i;
 
 	RTWN_LOCK(sc);
 	if (!(sc->sc_flags & RTWN_STARTED)) {
@@ -1994,11 +2303,19 @@ rtwn_stop(struct rtwn_softc *sc)
 	callout_stop(&sc->sc_watchdog_to);
 	sc->sc_tx_timer = 0;
 #endif
+	rtwn_ps_stop(sc);
+	sc->sc_offchan = 0;
 	sc->sc_flags &= ~(RTWN_STARTED | RTWN_RUNNING | RTWN_FW_LOADED);
 	sc->sc_flags &= ~RTWN_TEMP_MEASURED;
 	sc->fwver = 0;
 	sc->thcal_temp = 0;
 	sc->cur_bcnq_id = RTWN_VAP_ID_INVALID;
+	for (i = 0; i < RTWN_PORT_COUNT; i++)
+		rtwn_tsf_est_reset(sc, i);
+	sc->sc_tsf_pending = 0;
+#ifndef RTWN_WITHOUT_UCODE
+	rtwn_fw_h2c_reset(sc);
+#endif
 
 #ifdef D4054
 	ieee80211_tx_watchdog_stop(&sc->sc_ic);
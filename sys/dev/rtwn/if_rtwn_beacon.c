@@ -48,6 +48,10 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/rtl8192c/r92c_reg.h>
 
 
+static int	rtwn_beacon_changed(struct rtwn_vap *);
+static void	rtwn_beacon_save(struct rtwn_vap *);
+
+
 static void
 rtwn_reset_beacon_valid(struct rtwn_softc *sc, int id)
 {
@@ -130,6 +134,7 @@ rtwn_setup_beacon(struct rtwn_softc *sc, struct ieee80211_node *ni)
 	}
 
 	uvp->bcn_mbuf = m;
+	uvp->bcn_last_len = 0;
 
 	rtwn_beacon_set_rate(sc, &uvp->bcn_desc.txd[0],
 	    IEEE80211_IS_CHAN_5GHZ(ni->ni_chan));
@@ -157,6 +162,53 @@ rtwn_tx_beacon(struct rtwn_softc *sc, struct rtwn_vap *uvp)
 	return (error);
 }
 
+/* Compare the beacon frame with the last pushed one. */
+static int
+rtwn_beacon_changed(struct rtwn_vap *uvp)
+{
+	struct mbuf *m = uvp->bcn_mbuf;
+	int off;
+
+	if (uvp->bcn_last_len == 0 ||
+	    uvp->bcn_last_len != m->m_pkthdr.len)
+		return (1);
+
+	for (off = 0; m != NULL; m = m->m_next) {
+		if (memcmp(uvp->bcn_last + off, mtod(m, const void *),
+		    m->m_len) != 0)
+			return (1);
+		off += m->m_len;
+	}
+
+	return (0);
+}
+
+/* Remember the pushed frame; on failure the next one is always pushed. */
+static void
+rtwn_beacon_save(struct rtwn_vap *uvp)
+{
+	struct mbuf *m = uvp->bcn_mbuf;
+
+	if (uvp->bcn_last_size < m->m_pkthdr.len) {
+		free(uvp->bcn_last, M_DEVBUF);
+		uvp->bcn_last = malloc(m->m_pkthdr.len, M_DEVBUF, M_NOWAIT);
+		uvp->bcn_last_size =
+		    (uvp->bcn_last != NULL) ? m->m_pkthdr.len : 0;
+	}
+	if (uvp->bcn_last == NULL) {
+		uvp->bcn_last_len = 0;
+		return;
+	}
+
+	m_copydata(m, 0, m->m_pkthdr.len, uvp->bcn_last);
+	uvp->bcn_last_len = m->m_pkthdr.len;
+}
+
+/*
+ * Beacon updates are coalesced: all items requested within one
+ * beacon interval are applied by a single rtwn_update_beacon_task()
+ * run, and the frame is pushed into the chip only if it was changed.
+ */
 void
 rtwn_update_beacon(struct ieee80211vap *vap, int item)
 {
@@ -165,7 +217,7 @@ rtwn_update_beacon(struct ieee80211vap *vap, int item)
 	struct rtwn_vap *uvp = RTWN_VAP(vap);
 	struct ieee80211_beacon_offsets *bo = &vap->iv_bcn_off;
 	struct ieee80211_node *ni = vap->iv_bss;
-	int mcast = 0;
+	int delay;
 
 	RTWN_LOCK(sc);
 	if (uvp->bcn_mbuf == NULL) {
@@ -176,44 +228,98 @@ rtwn_update_beacon(struct ieee80211vap *vap, int item)
 			RTWN_UNLOCK(sc);
 			return;
 		}
+		uvp->bcn_last_len = 0;
 	}
 
 	RTWN_DPRINTF(sc, RTWN_DEBUG_BEACON,
 	    "%s: vap id %d, iv_csa_count %d, ic_csa_count %d, item %d\n",
 	    __func__, uvp->id, vap->iv_csa_count, ic->ic_csa_count, item);
 
-	switch (item) {
-	case IEEE80211_BEACON_CSA:
-		if (vap->iv_csa_count != ic->ic_csa_count) {
-			/*
-			 * XXX two APs with different beacon intervals
-			 * are not handled properly.
-			 */
-			/* XXX check TBTT? */
-			taskqueue_enqueue_timeout(taskqueue_thread,
-			    &uvp->tx_beacon_csa,
-			    msecs_to_ticks(ni->ni_intval));
-		}
-		break;
-	case IEEE80211_BEACON_TIM:
-		mcast = 1;	/* XXX */
-		break;
-	default:
-		break;
+	if (item == IEEE80211_BEACON_CSA &&
+	    vap->iv_csa_count != ic->ic_csa_count) {
+		/*
+		 * XXX two APs with different beacon intervals
+		 * are not handled properly.
+		 */
+		/* XXX check TBTT? */
+		taskqueue_enqueue_timeout(taskqueue_thread,
+		    &uvp->tx_beacon_csa, msecs_to_ticks(ni->ni_intval));
 	}
 
 	setbit(bo->bo_flags, item);
+	sc->sc_bcn_upd_requested++;
+
+	if (uvp->bcn_upd_items != 0 && item != IEEE80211_BEACON_CSA) {
+		/* Will be applied by the pending update. */
+		uvp->bcn_upd_items |= 1 << item;
+		sc->sc_bcn_upd_merged++;
+		RTWN_UNLOCK(sc);
+		return;
+	}
+	uvp->bcn_upd_items |= 1 << item;
+
+	/* CSA countdown cannot wait; others - once per beacon interval. */
+	delay = 0;
+	if (item != IEEE80211_BEACON_CSA) {
+		delay = uvp->bcn_upd_last + msecs_to_ticks(ni->ni_intval) -
+		    ticks;
+		if (delay < 0 || delay > hz)
+			delay = 0;
+	}
+	taskqueue_enqueue_timeout(taskqueue_thread, &uvp->bcn_upd_task, delay);
+	RTWN_UNLOCK(sc);
+}
+
+void
+rtwn_update_beacon_task(void *arg, int npending __unused)
+{
+	struct ieee80211vap *vap = arg;
+	struct ieee80211com *ic = vap->iv_ic;
+	struct rtwn_softc *sc = ic->ic_softc;
+	struct rtwn_vap *uvp = RTWN_VAP(vap);
+	struct ieee80211_beacon_offsets *bo = &vap->iv_bcn_off;
+	struct ieee80211_node *ni = vap->iv_bss;
+	uint32_t items;
+	int tag;
+
+	RTWN_LOCK(sc);
+	items = uvp->bcn_upd_items;
+	uvp->bcn_upd_items = 0;
+	if (items == 0 || uvp->bcn_mbuf == NULL ||
+	    !(sc->sc_flags & RTWN_RUNNING)) {
+		RTWN_UNLOCK(sc);
+		return;
+	}
 
 	rtwn_beacon_update_begin(sc, vap);
 	RTWN_UNLOCK(sc);
 
-	ieee80211_beacon_update(ni, uvp->bcn_mbuf, mcast);
+	/* XXX TIM is the only item which needs multicast bit. */
+	ieee80211_beacon_update(ni, uvp->bcn_mbuf,
+	    (items & (1 << IEEE80211_BEACON_TIM)) != 0);
 
 	/* XXX clear manually */
 	clrbit(bo->bo_flags, IEEE80211_BEACON_CSA);
 
 	RTWN_LOCK(sc);
-	rtwn_tx_beacon(sc, uvp);
+	/* The frame may have been replaced in the meantime. */
+	if (uvp->bcn_mbuf != NULL) {
+		if (rtwn_beacon_changed(uvp)) {
+			RTWN_REGACCT_SET(sc, RTWN_REGACCT_BEACON, tag);
+			if (rtwn_tx_beacon(sc, uvp) == 0)
+				rtwn_beacon_save(uvp);
+			else
+				uvp->bcn_last_len = 0;
+			RTWN_REGACCT_RESTORE(sc, tag);
+			sc->sc_bcn_upd_pushed++;
+		} else {
+			RTWN_DPRINTF(sc, RTWN_DEBUG_BEACON,
+			    "%s: vap id %d: beacon was not changed\n",
+			    __func__, uvp->id);
+			sc->sc_bcn_upd_unchanged++;
+		}
+	}
+	uvp->bcn_upd_last = ticks;
 	rtwn_beacon_update_end(sc, vap);
 	RTWN_UNLOCK(sc);
 }
@@ -245,8 +351,9 @@ rtwn_tx_beacon_csa(void *arg, int npending __unused)
 int
 rtwn_tx_beacon_check(struct rtwn_softc *sc, struct rtwn_vap *uvp)
 {
-	int ntries, error;
+	int ntries, error, tag;
 
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_BEACON, tag);
 	for (ntries = 0; ntries < 5; ntries++) {
 		rtwn_reset_beacon_valid(sc, uvp->id);
 
@@ -258,6 +365,7 @@ rtwn_tx_beacon_check(struct rtwn_softc *sc, struct rtwn_vap *uvp)
 		if (error == 0)
 			break;
 	}
+	RTWN_REGACCT_RESTORE(sc, tag);
 	if (ntries == 5) {
 		device_printf(sc->sc_dev,
 		    "%s: cannot push beacon into chip, error %d!\n",
@@ -104,6 +104,10 @@ rtwn_temp_calib(struct rtwn_softc *sc)
 static void
 rtwn_calib_cb(struct rtwn_softc *sc, union sec_param *data)
 {
+	int tag;
+
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_CALIB, tag);
+
 	/* Do temperature compensation. */
 	rtwn_temp_calib(sc);
 
@@ -114,6 +118,8 @@ rtwn_calib_cb(struct rtwn_softc *sc, union sec_param *data)
 	}
 #endif
 
+	RTWN_REGACCT_RESTORE(sc, tag);
+
 	if (sc->vaps_running > sc->monvaps_running)
 		callout_reset(&sc->sc_calib_to, 2*hz, rtwn_calib_to, sc);
 }
@@ -126,3 +132,41 @@ rtwn_calib_to(void *arg)
 	/* Do it in a process context. */
 	rtwn_cmd_sleepable(sc, NULL, 0, rtwn_calib_cb);
 }
+
+/*
+ * Save a list of 32-bit (BB / AFE) registers; runs of adjacent
+ * registers are fetched with a single region read.
+ */
+void
+rtwn_regs_save(struct rtwn_softc *sc, uint32_t vals[],
+    const uint16_t regs[], int size)
+{
+	uint8_t buf[RTWN_REGS_RUN_MAX * 4];
+	int i, j, k;
+
+	for (i = 0; i < size; i = j) {
+		for (j = i + 1; j < size && j - i < RTWN_REGS_RUN_MAX &&
+		    regs[j] == regs[j - 1] + 4; j++)
+			;
+
+		if (j - i == 1) {
+			vals[i] = rtwn_read_4(sc, regs[i]);
+			continue;
+		}
+
+		if (rtwn_read_region(sc, regs[i], buf, (j - i) * 4) != 0)
+			memset(buf, 0xff, sizeof(buf));
+		for (k = i; k < j; k++)
+			vals[k] = le32dec(&buf[(k - i) * 4]);
+	}
+}
+
+void
+rtwn_regs_restore(struct rtwn_softc *sc, const uint32_t vals[],
+    const uint16_t regs[], int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		rtwn_write_4(sc, regs[i], vals[i]);
+}
@@ -19,6 +19,12 @@
 #ifndef IF_RTWN_CALIB_H
 #define IF_RTWN_CALIB_H
 
+#define RTWN_REGS_RUN_MAX	16
+
 void	rtwn_calib_to(void *);
+void	rtwn_regs_save(struct rtwn_softc *, uint32_t[], const uint16_t[],
+	    int);
+void	rtwn_regs_restore(struct rtwn_softc *, const uint32_t[],
+	    const uint16_t[], int);
 
 #endif	/* IF_RTWN_CALIB_H */
@@ -35,6 +35,8 @@ __FBSDID("$FreeBSD$");
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
 
 #include <net/if.h>
 #include <net/ethernet.h>
@@ -59,23 +61,96 @@ rtwn_init_cam(struct rtwn_softc *sc)
 	/* Invalidate all CAM entries. */
 	rtwn_write_4(sc, R92C_CAMCMD,
 	    R92C_CAMCMD_POLLING | R92C_CAMCMD_CLR);
+	memset(sc->cam_shadow, 0, sizeof(sc->cam_shadow));
 }
 
+/*
+ * Write a sequence of CAM words.  R92C_CAMCMD and R92C_CAMWRITE are
+ * adjacent and a region write updates registers in ascending order
+ * (like the POLLING bit in the upper byte of a plain CAMCMD write),
+ * so each command is sent together with the data for the next word:
+ * 'n' words take n + 1 register writes instead of 2 * n.
+ */
 static int
-rtwn_cam_write(struct rtwn_softc *sc, uint32_t addr, uint32_t data)
+rtwn_cam_write_seq(struct rtwn_softc *sc, const uint16_t *addr,
+    const uint32_t *data, int n)
 {
-	int error;
+	uint8_t buf[8];
+	uint32_t cmd;
+	int error, i, tag;
 
-	error = rtwn_write_4(sc, R92C_CAMWRITE, data);
-	if (error != 0)
-		return (error);
-	error = rtwn_write_4(sc, R92C_CAMCMD,
-	    R92C_CAMCMD_POLLING | R92C_CAMCMD_WRITE |
-	    SM(R92C_CAMCMD_ADDR, addr));
+	if (n == 0)
+		return (0);
+
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_CAM, tag);
+	error = rtwn_write_4(sc, R92C_CAMWRITE, data[0]);
+	for (i = 0; i < n && error == 0; i++) {
+		cmd = R92C_CAMCMD_POLLING | R92C_CAMCMD_WRITE |
+		    SM(R92C_CAMCMD_ADDR, addr[i]);
+		if (i == n - 1) {
+			error = rtwn_write_4(sc, R92C_CAMCMD, cmd);
+			break;
+		}
+
+		le32enc(&buf[0], cmd);
+		le32enc(&buf[4], data[i + 1]);
+		error = rtwn_write_region(sc, R92C_CAMCMD, buf, sizeof(buf));
+	}
+	RTWN_REGACCT_RESTORE(sc, tag);
 
 	return (error);
 }
 
+/*
+ * Program the whole CAM entry in one batch; words which are already
+ * in the hardware (according to the shadow copy) are skipped.
+ */
+static int
+rtwn_cam_write_entry(struct rtwn_softc *sc, int idx, const uint32_t *words)
+{
+	uint32_t *shadow = sc->cam_shadow[idx];
+	uint32_t data[RTWN_CAM_ENTRY_WORDS + 1];
+	uint16_t addr[RTWN_CAM_ENTRY_WORDS + 1];
+	int i, n, w, error;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	n = 0;
+
+	/* Invalidate the entry first if its contents are going to change. */
+	if ((shadow[0] & R92C_CAM_VALID) &&
+	    memcmp(&shadow[1], &words[1],
+	    sizeof(*words) * (RTWN_CAM_ENTRY_WORDS - 1)) != 0) {
+		addr[n] = R92C_CAM_CTL0(idx);
+		data[n++] = 0;
+		shadow[0] = 0;
+	}
+
+	/* Write CTL0 last since that will validate the CAM entry. */
+	for (i = 1; i <= RTWN_CAM_ENTRY_WORDS; i++) {
+		w = i % RTWN_CAM_ENTRY_WORDS;
+		if (shadow[w] == words[w]) {
+			sc->cam_writes_skipped++;
+			continue;
+		}
+		addr[n] = R92C_CAM_CTL0(idx) + w;
+		data[n++] = words[w];
+	}
+
+	error = rtwn_cam_write_seq(sc, addr, data, n);
+	if (error != 0) {
+		/* Hardware state is unknown; do not skip anything next time. */
+		for (w = 0; w < RTWN_CAM_ENTRY_WORDS; w++)
+			shadow[w] = ~words[w];
+		return (error);
+	}
+
+	memcpy(shadow, words, sizeof(*words) * RTWN_CAM_ENTRY_WORDS);
+	sc->cam_writes += n;
+
+	return (0);
+}
+
 void
 rtwn_init_seccfg(struct rtwn_softc *sc)
 {
@@ -175,6 +250,15 @@ rtwn_key_alloc(struct ieee80211vap *vap, struct ieee80211_key *k,
 			break;
 		}
 	}
+	/*
+	 * NB: keys in use are never evicted: they cannot be switched to
+	 * software crypto safely while net80211 may encrypt / decrypt
+	 * frames with them.
+	 */
+	if (i != sc->cam_entry_limit)
+		sc->cam_allocs++;
+	else
+		sc->cam_swcrypt++;
 	RTWN_UNLOCK(sc);
 	if (i == sc->cam_entry_limit) {
 #if __FreeBSD_version > 1200008
@@ -196,6 +280,7 @@ end:
 static int
 rtwn_key_set_cb0(struct rtwn_softc *sc, const struct ieee80211_key *k)
 {
+	uint32_t words[RTWN_CAM_ENTRY_WORDS];
 	uint8_t algo, keyid;
 	int i, error;
 
@@ -231,28 +316,16 @@ rtwn_key_set_cb0(struct rtwn_softc *sc, const struct ieee80211_key *k)
 	    k->wk_cipher->ic_cipher, algo, k->wk_flags, k->wk_keylen,
 	    ether_sprintf(k->wk_macaddr));
 
-	/* Clear high bits. */
-	rtwn_cam_write(sc, R92C_CAM_CTL6(k->wk_keyix), 0);
-	rtwn_cam_write(sc, R92C_CAM_CTL7(k->wk_keyix), 0);
-
-	/* Write key. */
-	for (i = 0; i < 4; i++) {
-		error = rtwn_cam_write(sc, R92C_CAM_KEY(k->wk_keyix, i),
-		    le32dec(&k->wk_key[i * 4]));
-		if (error != 0)
-			goto fail;
-	}
-
-	/* Write CTL0 last since that will validate the CAM entry. */
-	error = rtwn_cam_write(sc, R92C_CAM_CTL1(k->wk_keyix),
-	    le32dec(&k->wk_macaddr[2]));
-	if (error != 0)
-		goto fail;
-	error = rtwn_cam_write(sc, R92C_CAM_CTL0(k->wk_keyix),
-	    SM(R92C_CAM_ALGO, algo) |
+	memset(words, 0, sizeof(words));
+	words[0] = SM(R92C_CAM_ALGO, algo) |
 	    SM(R92C_CAM_KEYID, keyid) |
 	    SM(R92C_CAM_MACLO, le16dec(&k->wk_macaddr[0])) |
-	    R92C_CAM_VALID);
+	    R92C_CAM_VALID;
+	words[1] = le32dec(&k->wk_macaddr[2]);
+	for (i = 0; i < 4; i++)
+		words[2 + i] = le32dec(&k->wk_key[i * 4]);
+
+	error = rtwn_cam_write_entry(sc, k->wk_keyix, words);
 	if (error != 0)
 		goto fail;
 
@@ -295,18 +368,15 @@ static void
 rtwn_key_del_cb(struct rtwn_softc *sc, union sec_param *data)
 {
 	struct ieee80211_key *k = &data->key;
-	int i;
+	uint32_t words[RTWN_CAM_ENTRY_WORDS];
 
 	RTWN_DPRINTF(sc, RTWN_DEBUG_KEY,
 	    "%s: keyix %u, flags %04X, macaddr %s\n", __func__,
 	    k->wk_keyix, k->wk_flags, ether_sprintf(k->wk_macaddr));
 
-	rtwn_cam_write(sc, R92C_CAM_CTL0(k->wk_keyix), 0);
-	rtwn_cam_write(sc, R92C_CAM_CTL1(k->wk_keyix), 0);
-
-	/* Clear key. */
-	for (i = 0; i < 4; i++)
-		rtwn_cam_write(sc, R92C_CAM_KEY(k->wk_keyix, i), 0);
+	/* Invalidate the entry and clear the key. */
+	memset(words, 0, sizeof(words));
+	rtwn_cam_write_entry(sc, k->wk_keyix, words);
 	clrbit(sc->keys_bmap, k->wk_keyix);
 }
 
@@ -362,3 +432,44 @@ rtwn_key_delete(struct ieee80211vap *vap, const struct ieee80211_key *k)
 {
 	return (rtwn_process_key(vap, k, 0));
 }
+
+static int
+rtwn_cam_sysctl_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct sbuf sb;
+	uint32_t allocs, swcrypt, writes, skipped;
+	int error, i, used;
+
+	RTWN_LOCK(sc);
+	allocs = sc->cam_allocs;
+	swcrypt = sc->cam_swcrypt;
+	writes = sc->cam_writes;
+	skipped = sc->cam_writes_skipped;
+	used = 0;
+	for (i = 0; i < sc->cam_entry_limit; i++)
+		if (isset(sc->keys_bmap, i))
+			used++;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "\nslots: %d/%d used\n", used, sc->cam_entry_limit);
+	sbuf_printf(&sb, "keys: %u in hardware, %u software fallback\n",
+	    allocs, swcrypt);
+	sbuf_printf(&sb, "writes: %u, %u skipped\n", writes, skipped);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
+
+void
+rtwn_cam_sysctlattach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "cam_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_cam_sysctl_stats, "A", "Key table statistics");
+}
@@ -26,5 +26,6 @@ int	rtwn_key_alloc(struct ieee80211vap *, struct ieee80211_key *,
 int	rtwn_key_set(struct ieee80211vap *, const struct ieee80211_key *);
 int	rtwn_init_static_keys(struct rtwn_softc *, struct rtwn_vap *);
 int	rtwn_key_delete(struct ieee80211vap *, const struct ieee80211_key *);
+void	rtwn_cam_sysctlattach(struct rtwn_softc *);
 
 #endif	/* IF_RTWN_CAM_H */
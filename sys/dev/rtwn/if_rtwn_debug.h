@@ -43,6 +43,8 @@ enum {
 	RTWN_DEBUG_RESET	= 0x00008000,	/* initialization progress */
 	RTWN_DEBUG_CALIB	= 0x00010000,	/* calibration progress */
 	RTWN_DEBUG_RADAR	= 0x00020000,	/* radar detection status */
+	RTWN_DEBUG_TSF		= 0x00040000,	/* TSF tracking */
+	RTWN_DEBUG_PS		= 0x00080000,	/* power save policy */
 	RTWN_DEBUG_ANY		= 0xffffffff
 };
 
@@ -37,6 +37,8 @@ __FBSDID("$FreeBSD$");
 #include <sys/endian.h>
 #include <sys/linker.h>
 #include <sys/firmware.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
 
 #include <net/if.h>
 #include <net/ethernet.h>
@@ -222,3 +224,244 @@ fail:
 	return (error);
 }
 #endif
+
+#ifndef RTWN_WITHOUT_UCODE
+static void
+rtwn_fw_h2c_dequeue(struct rtwn_softc *sc)
+{
+	sc->h2c_first = (sc->h2c_first + 1) % RTWN_H2C_QSIZE;
+	sc->h2c_count--;
+	sc->h2c_stall = 0;
+}
+
+static int
+rtwn_fw_h2c_write(struct rtwn_softc *sc, const struct rtwn_h2c *cmd)
+{
+	uint16_t reg;
+	int error;
+
+	/* Write the first word last since that will trigger the FW. */
+	reg = cmd->ext_reg + sc->fwcur * cmd->ext_len;
+	switch (cmd->ext_len) {
+	case 2:
+		error = rtwn_write_2(sc, reg, cmd->ext);
+		break;
+	case 4:
+		error = rtwn_write_4(sc, reg, cmd->ext);
+		break;
+	default:
+		error = 0;
+		break;
+	}
+	if (error != 0)
+		return (error);
+
+	return (rtwn_write_4(sc, R92C_HMEBOX(sc->fwcur), cmd->box));
+}
+
+/*
+ * Push queued commands into all idle mailboxes; never waits
+ * for the firmware.
+ */
+static void
+rtwn_fw_h2c_kick(struct rtwn_softc *sc)
+{
+	struct rtwn_h2c *cmd;
+	struct rtwn_h2c_stat *st;
+	sbintime_t now;
+	uint32_t lat;
+	uint8_t busy;
+	int error, tag;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (sc->h2c_count == 0)
+		return;
+
+	if (!(sc->sc_flags & RTWN_FW_LOADED)) {
+		sc->h2c_dropped += sc->h2c_count;
+		rtwn_fw_h2c_reset(sc);
+		return;
+	}
+
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_FW, tag);
+	busy = rtwn_read_1(sc, R92C_HMETFR);
+	while (sc->h2c_count != 0) {
+		cmd = &sc->h2c_ring[sc->h2c_first];
+		now = sbinuptime();
+
+		if (busy & (1 << sc->fwcur)) {
+			if (sc->h2c_stall == 0)
+				sc->h2c_stall = now;
+			else if (now - sc->h2c_stall > RTWN_H2C_TIMEOUT) {
+				device_printf(sc->sc_dev,
+				    "could not send firmware command "
+				    "(id %u)\n", cmd->id);
+				sc->h2c_timeouts++;
+				rtwn_fw_h2c_dequeue(sc);
+				continue;
+			}
+			break;
+		}
+
+		error = rtwn_fw_h2c_write(sc, cmd);
+		if (error != 0) {
+			RTWN_DPRINTF(sc, RTWN_DEBUG_FIRMWARE,
+			    "%s: cannot write command (id %u), error %d\n",
+			    __func__, cmd->id, error);
+			sc->h2c_dropped++;
+			rtwn_fw_h2c_dequeue(sc);
+			continue;
+		}
+
+		lat = sbttous(now - cmd->queued);
+		st = &sc->h2c_stats[cmd->id % RTWN_H2C_NID];
+		st->sent++;
+		st->lat_sum += lat;
+		if (st->lat_max < lat)
+			st->lat_max = lat;
+
+		busy |= 1 << sc->fwcur;
+		sc->fwcur = (sc->fwcur + 1) % R92C_H2C_NBOX;
+		rtwn_fw_h2c_dequeue(sc);
+	}
+	RTWN_REGACCT_RESTORE(sc, tag);
+
+	if (sc->h2c_count != 0) {
+		taskqueue_enqueue_timeout(taskqueue_thread, &sc->h2c_task,
+		    RTWN_H2C_POLL);
+	}
+}
+
+static void
+rtwn_fw_h2c_task(void *arg, int pending)
+{
+	struct rtwn_softc *sc = arg;
+
+	RTWN_LOCK(sc);
+	rtwn_fw_h2c_kick(sc);
+	RTWN_UNLOCK(sc);
+}
+
+void
+rtwn_fw_h2c_init(struct rtwn_softc *sc)
+{
+	TIMEOUT_TASK_INIT(taskqueue_thread, &sc->h2c_task, 0,
+	    rtwn_fw_h2c_task, sc);
+}
+
+void
+rtwn_fw_h2c_reset(struct rtwn_softc *sc)
+{
+	sc->fwcur = 0;
+	sc->h2c_first = 0;
+	sc->h2c_count = 0;
+	sc->h2c_stall = 0;
+	taskqueue_cancel_timeout(taskqueue_thread, &sc->h2c_task, NULL);
+}
+
+void
+rtwn_fw_h2c_drain(struct rtwn_softc *sc)
+{
+	taskqueue_drain_timeout(taskqueue_thread, &sc->h2c_task);
+}
+
+/*
+ * Queue a firmware command.  If the last queued command has the same
+ * id and merge key it is superseded by the new one (so the order of
+ * commands is never changed).
+ * NB: only queueing errors are returned; mailbox write errors and
+ * timeouts are detected later by rtwn_fw_h2c_kick() (see the
+ * h2c_dropped / h2c_timeouts counters).
+ */
+int
+rtwn_fw_h2c_submit(struct rtwn_softc *sc, const struct rtwn_h2c *cmd)
+{
+	struct rtwn_h2c *c;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (!(sc->sc_flags & RTWN_FW_LOADED)) {
+		RTWN_DPRINTF(sc, RTWN_DEBUG_FIRMWARE, "%s: firmware "
+		    "was not loaded; command (id %u) will be discarded\n",
+		    __func__, cmd->id);
+		return (0);
+	}
+
+	if (cmd->key != RTWN_H2C_NOMERGE && sc->h2c_count != 0) {
+		c = &sc->h2c_ring[(sc->h2c_first + sc->h2c_count - 1) %
+		    RTWN_H2C_QSIZE];
+		if (c->id == cmd->id && c->key == cmd->key) {
+			c->box = cmd->box;
+			c->ext = cmd->ext;
+			sc->h2c_stats[cmd->id % RTWN_H2C_NID].merged++;
+			return (0);
+		}
+	}
+
+	if (sc->h2c_count == RTWN_H2C_QSIZE) {
+		rtwn_fw_h2c_kick(sc);
+		if (sc->h2c_count == RTWN_H2C_QSIZE) {
+			sc->h2c_dropped++;
+			return (ENOBUFS);
+		}
+	}
+
+	c = &sc->h2c_ring[(sc->h2c_first + sc->h2c_count) % RTWN_H2C_QSIZE];
+	*c = *cmd;
+	c->queued = sbinuptime();
+	sc->h2c_count++;
+
+	rtwn_fw_h2c_kick(sc);
+
+	return (0);
+}
+
+static int
+rtwn_fw_sysctl_h2c_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct rtwn_h2c_stat *stats, *st;
+	struct sbuf sb;
+	uint32_t dropped, timeouts;
+	int error, i;
+
+	/* Take a snapshot; sysctl output may sleep. */
+	stats = malloc(sizeof(sc->h2c_stats), M_TEMP, M_WAITOK);
+	RTWN_LOCK(sc);
+	memcpy(stats, sc->h2c_stats, sizeof(sc->h2c_stats));
+	dropped = sc->h2c_dropped;
+	timeouts = sc->h2c_timeouts;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 256, req);
+	sbuf_printf(&sb, "\ndropped %u, timeouts %u\n", dropped, timeouts);
+	sbuf_printf(&sb, "  id       sent   merged  lat avg  lat max\n");
+	for (i = 0; i < RTWN_H2C_NID; i++) {
+		st = &stats[i];
+		if (st->sent == 0 && st->merged == 0)
+			continue;
+
+		sbuf_printf(&sb, "0x%02x %10u %8u %8ju %8u\n", i, st->sent,
+		    st->merged, st->sent != 0 ?
+		    (uintmax_t)(st->lat_sum / st->sent) : 0, st->lat_max);
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	free(stats, M_TEMP);
+
+	return (error);
+}
+
+void
+rtwn_fw_sysctlattach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "h2c_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_fw_sysctl_h2c_stats, "A",
+	    "Firmware command statistics (latency in usec)");
+}
+#endif
@@ -53,7 +53,19 @@ struct r92c_fw_hdr {
 	uint32_t	reserved5;
 } __packed;
 
+/*
+ * H2C command queue.
+ */
+#define RTWN_H2C_TIMEOUT		(100 * SBT_1MS)
+#define RTWN_H2C_POLL			MAX(1, hz / 500)	/* 2 ms */
+
 
 int		rtwn_load_firmware(struct rtwn_softc *);
+void		rtwn_fw_h2c_init(struct rtwn_softc *);
+void		rtwn_fw_h2c_reset(struct rtwn_softc *);
+void		rtwn_fw_h2c_drain(struct rtwn_softc *);
+int		rtwn_fw_h2c_submit(struct rtwn_softc *,
+		    const struct rtwn_h2c *);
+void		rtwn_fw_sysctlattach(struct rtwn_softc *);
 
 #endif	/* IF_RTWN_FW_H */
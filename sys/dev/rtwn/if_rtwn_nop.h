@@ -31,7 +31,8 @@ rtwn_nop_int_softc(struct rtwn_softc *sc)
 }
 
 static __inline int
-rtwn_nop_int_softc_mbuf(struct rtwn_softc *sc, struct mbuf *m)
+rtwn_nop_int_softc_mbuf_desc(struct rtwn_softc *sc, struct mbuf *m,
+    const void *desc)
 {
 	return (0);
 }
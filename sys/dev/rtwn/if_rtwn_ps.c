@@ -0,0 +1,245 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Traffic-aware leisure power save (LPS).
+ *
+ * Data frames are counted in both directions; the firmware is kept
+ * awake while the frame rate exceeds dev.rtwn.N.ps_thresh and is put
+ * into LPS after dev.rtwn.N.ps_idle msec of idle time (and into a
+ * deeper mode with longer sleep periods if the link stays idle).
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include "opt_wlan.h"
+
+#include <sys/param.h>
+#include <sys/sysctl.h>
+#include <sys/sbuf.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/mbuf.h>
+#include <sys/kernel.h>
+#include <sys/socket.h>
+#include <sys/systm.h>
+#include <sys/malloc.h>
+#include <sys/queue.h>
+#include <sys/taskqueue.h>
+#include <sys/bus.h>
+#include <sys/endian.h>
+
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_media.h>
+
+#include <net80211/ieee80211_var.h>
+#include <net80211/ieee80211_radiotap.h>
+
+#include <dev/rtwn/if_rtwnvar.h>
+
+#include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_ps.h>
+#include <dev/rtwn/if_rtwn_task.h>
+
+static void	rtwn_ps_account(struct rtwn_softc *, int);
+static void	rtwn_ps_set_level(struct rtwn_softc *, int);
+static void	rtwn_ps_cb(struct rtwn_softc *, union sec_param *);
+static void	rtwn_ps_to(void *);
+static int	rtwn_sysctl_ps_stats(SYSCTL_HANDLER_ARGS);
+
+static const char *rtwn_ps_level_names[RTWN_PS_MAX] = {
+	"awake", "lps", "deep"
+};
+
+
+void
+rtwn_ps_init(struct rtwn_softc *sc)
+{
+	callout_init_mtx(&sc->sc_ps_to, &sc->sc_mtx, 0);
+	sc->sc_ps_level = RTWN_PS_AWAKE;
+	sc->sc_ps_since = ticks;
+}
+
+/* Wait for the policy callout; called on detach (unlocked). */
+void
+rtwn_ps_detach(struct rtwn_softc *sc)
+{
+	callout_drain(&sc->sc_ps_to);
+}
+
+static void
+rtwn_ps_account(struct rtwn_softc *sc, int level)
+{
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	RTWN_DPRINTF(sc, RTWN_DEBUG_PS, "%s: %s -> %s\n", __func__,
+	    rtwn_ps_level_names[sc->sc_ps_level], rtwn_ps_level_names[level]);
+
+	sc->sc_ps_time[sc->sc_ps_level] += ticks - sc->sc_ps_since;
+	sc->sc_ps_since = ticks;
+	sc->sc_ps_level = level;
+	sc->sc_ps_transitions++;
+}
+
+static void
+rtwn_ps_set_level(struct rtwn_softc *sc, int level)
+{
+
+	if (sc->sc_ps_level == level)
+		return;
+
+	rtwn_ps_account(sc, level);
+
+	/* Firmware commands cannot be sent from callout context (USB). */
+	rtwn_cmd_sleepable(sc, NULL, 0, rtwn_ps_cb);
+}
+
+static void
+rtwn_ps_cb(struct rtwn_softc *sc, union sec_param *data)
+{
+	struct rtwn_vap *uvp = sc->vaps[0];
+
+	/* NB: chip code will pick the mode from sc_ps_level. */
+	if (uvp != NULL && uvp->vap.iv_state == IEEE80211_S_RUN)
+		rtwn_set_pwrmode(sc, &uvp->vap, 1);
+}
+
+static void
+rtwn_ps_to(void *arg)
+{
+	struct rtwn_softc *sc = arg;
+	struct rtwn_vap *uvp = sc->vaps[0];
+	int idle, level;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (sc->sc_ps_frames * hz >= sc->sc_ps_thresh * RTWN_PS_INTERVAL)
+		sc->sc_ps_busy = ticks;
+	sc->sc_ps_frames = 0;
+
+	idle = msecs_to_ticks(sc->sc_ps_idle);
+	if (uvp == NULL || !(uvp->vap.iv_flags & IEEE80211_F_PMGTON))
+		level = RTWN_PS_AWAKE;
+	else if (sc->sc_ps_thresh == 0)
+		level = RTWN_PS_LPS;	/* traffic is not checked */
+	else if (ticks - sc->sc_ps_busy < idle)
+		level = RTWN_PS_AWAKE;
+	else if (ticks - sc->sc_ps_busy < idle * RTWN_PS_DEEP_MULT)
+		level = RTWN_PS_LPS;
+	else
+		level = RTWN_PS_DEEP;
+	rtwn_ps_set_level(sc, level);
+
+	callout_reset(&sc->sc_ps_to, RTWN_PS_INTERVAL, rtwn_ps_to, sc);
+}
+
+void
+rtwn_ps_start(struct rtwn_softc *sc)
+{
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	sc->sc_ps_frames = 0;
+	sc->sc_ps_busy = ticks;
+	rtwn_ps_to(sc);
+}
+
+/*
+ * Stop the policy; the caller is responsible for switching
+ * the firmware back into CAM mode.
+ */
+void
+rtwn_ps_stop(struct rtwn_softc *sc)
+{
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	callout_stop(&sc->sc_ps_to);
+	if (sc->sc_ps_level != RTWN_PS_AWAKE)
+		rtwn_ps_account(sc, RTWN_PS_AWAKE);
+}
+
+void
+rtwn_ps_wakeup(struct rtwn_softc *sc)
+{
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	sc->sc_ps_busy = ticks;
+	rtwn_ps_set_level(sc, RTWN_PS_AWAKE);
+}
+
+static int
+rtwn_sysctl_ps_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	uint64_t t[RTWN_PS_MAX];
+	struct sbuf sb;
+	uint32_t transitions;
+	int error, i, level;
+
+	RTWN_LOCK(sc);
+	memcpy(t, sc->sc_ps_time, sizeof(t));
+	level = sc->sc_ps_level;
+	t[level] += ticks - sc->sc_ps_since;
+	transitions = sc->sc_ps_transitions;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "now %s, %u transitions",
+	    rtwn_ps_level_names[level], transitions);
+	for (i = 0; i < RTWN_PS_MAX; i++) {
+		sbuf_printf(&sb, ", %s %ju ms", rtwn_ps_level_names[i],
+		    (uintmax_t)(t[i] * 1000 / hz));
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
+
+void
+rtwn_ps_sysctlattach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	sc->sc_ps_thresh = RTWN_PS_THRESH_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "ps_thresh", CTLFLAG_RWTUN, &sc->sc_ps_thresh,
+	    sc->sc_ps_thresh, "Data frames per second which keep the device "
+	    "out of power save (0 - do not check traffic)");
+	sc->sc_ps_idle = RTWN_PS_IDLE_DEF;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "ps_idle", CTLFLAG_RWTUN, &sc->sc_ps_idle,
+	    sc->sc_ps_idle, "Idle time (in msec) before entering power save");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "ps_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_sysctl_ps_stats, "A", "Time spent in each power state");
+}
@@ -0,0 +1,54 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef IF_RTWN_PS_H
+#define IF_RTWN_PS_H
+
+#define RTWN_PS_INTERVAL	MAX(1, hz / 10)
+#define RTWN_PS_THRESH_DEF	20	/* frames / sec */
+#define RTWN_PS_IDLE_DEF	500	/* msec */
+#define RTWN_PS_DEEP_MULT	10	/* deep sleep after 10 * idle */
+
+void	rtwn_ps_init(struct rtwn_softc *);
+void	rtwn_ps_detach(struct rtwn_softc *);
+void	rtwn_ps_start(struct rtwn_softc *);
+void	rtwn_ps_stop(struct rtwn_softc *);
+void	rtwn_ps_wakeup(struct rtwn_softc *);
+void	rtwn_ps_sysctlattach(struct rtwn_softc *);
+
+/* Account a data frame; leave LPS early on a traffic burst. */
+static __inline void
+rtwn_ps_traffic(struct rtwn_softc *sc)
+{
+	sc->sc_ps_frames++;
+	if (sc->sc_ps_level != RTWN_PS_AWAKE && sc->sc_ps_thresh != 0 &&
+	    sc->sc_ps_frames * hz >= sc->sc_ps_thresh * RTWN_PS_INTERVAL)
+		rtwn_ps_wakeup(sc);
+}
+
+#endif	/* IF_RTWN_PS_H */
@@ -0,0 +1,349 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Driver-side rate control (RTWN_RATECTL_DRV).
+ *
+ * Success probability is tracked per rate from Tx reports and averaged
+ * (EWMA) every RTWN_RC_INTERVAL; the rate with the best expected
+ * throughput is used for data frames, and every RTWN_RC_SAMPLE_RATIO-th
+ * frame probes a rate which may do better.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include "opt_wlan.h"
+
+#include <sys/param.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/mbuf.h>
+#include <sys/kernel.h>
+#include <sys/socket.h>
+#include <sys/systm.h>
+#include <sys/malloc.h>
+#include <sys/queue.h>
+#include <sys/taskqueue.h>
+#include <sys/bus.h>
+#include <sys/endian.h>
+
+#include <machine/atomic.h>
+
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_media.h>
+
+#include <net80211/ieee80211_var.h>
+#include <net80211/ieee80211_radiotap.h>
+
+#include <dev/rtwn/if_rtwnvar.h>
+
+#include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_rc.h>
+#include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_rx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+
+static uint32_t	rtwn_rc_tp(uint8_t, uint16_t);
+static void	rtwn_rc_init(struct rtwn_softc *, struct ieee80211_node *);
+static void	rtwn_rc_update(struct rtwn_softc *, struct rtwn_rc_node *);
+static uint8_t	rtwn_rc_sample(struct rtwn_rc_node *);
+
+
+/* Expected throughput (kbps) for 1500-byte frames. */
+static uint32_t
+rtwn_rc_tp(uint8_t ridx, uint16_t prob)
+{
+	uint32_t usec;
+
+	usec = rtwn_stats_airtime(ridx, 1500);
+	if (usec == 0)
+		return (0);
+
+	return ((uint64_t)1500 * 8 * 1000 * prob / RTWN_RC_PROB_ONE / usec);
+}
+
+static void
+rtwn_rc_init(struct rtwn_softc *sc, struct ieee80211_node *ni)
+{
+	struct rtwn_rc_node *rc = &RTWN_NODE(ni)->rc;
+	uint32_t rates;
+	uint8_t ridx, start;
+	int maxrate;
+
+	rtwn_get_rates(sc, &ni->ni_rates,
+	    (ni->ni_flags & IEEE80211_NODE_HT) ? &ni->ni_htrates : NULL,
+	    &rates, &maxrate, 0);
+	if (sc->ntxchains == 1)
+		rates &= (1 << RTWN_RIDX_MCS(8)) - 1;
+	if (rates == 0) {
+		rates = 1 << (IEEE80211_IS_CHAN_5GHZ(ni->ni_chan) ?
+		    RTWN_RIDX_OFDM6 : RTWN_RIDX_CCK1);
+	}
+
+	memset(rc, 0, sizeof(*rc));
+	rc->rates = rates;
+	rc->probe_ridx = RTWN_RIDX_UNKNOWN;
+	rc->last_update = ticks;
+
+	/* Start from some middle rate. */
+	if (rates & ~((1 << RTWN_RIDX_MCS(0)) - 1))
+		start = RTWN_RIDX_MCS(4);
+	else
+		start = RTWN_RIDX_OFDM24;
+	rc->cur = ffs(rates) - 1;
+	for (ridx = rc->cur; ridx <= start; ridx++)
+		if (rates & (1 << ridx))
+			rc->cur = ridx;
+
+	RTWN_DPRINTF(sc, RTWN_DEBUG_RA,
+	    "%s: %6D: rates 0x%08X, initial ridx %u\n", __func__,
+	    ni->ni_macaddr, ":", rates, rc->cur);
+}
+
+static void
+rtwn_rc_update(struct rtwn_softc *sc, struct rtwn_rc_node *rc)
+{
+	struct rtwn_rc_stat *st;
+	uint32_t best_tp;
+	uint16_t prob, best_prob;
+	uint8_t ridx, best;
+
+	best = rc->cur;
+	best_tp = 0;
+	best_prob = 0;
+	for (ridx = 0; ridx < RTWN_STATS_NRATES; ridx++) {
+		if ((rc->rates & (1 << ridx)) == 0)
+			continue;
+
+		st = &rc->st[ridx];
+		if (st->attempts != 0) {
+			prob = st->success * RTWN_RC_PROB_ONE / st->attempts;
+			if (st->valid)
+				st->prob = (st->prob * 3 + prob) / 4;
+			else
+				st->prob = prob;
+			st->valid = 1;
+			st->attempts = st->success = 0;
+
+			if (st->prob < RTWN_RC_PROB_MIN)
+				st->tp = 0;
+			else
+				st->tp = rtwn_rc_tp(ridx, st->prob);
+		}
+
+		if (st->tp > best_tp || (st->tp == best_tp && st->tp != 0 &&
+		    st->prob > best_prob)) {
+			best = ridx;
+			best_tp = st->tp;
+			best_prob = st->prob;
+		}
+	}
+
+	/* Nothing works (yet); fall back to the lowest rate. */
+	if (best_tp == 0 && rc->st[rc->cur].valid)
+		best = ffs(rc->rates) - 1;
+
+	if (best != rc->cur) {
+		RTWN_DPRINTF(sc, RTWN_DEBUG_RA,
+		    "%s: ridx %u -> %u (tp %u kbps, prob %u/%u)\n",
+		    __func__, rc->cur, best, best_tp, best_prob,
+		    RTWN_RC_PROB_ONE);
+		rc->cur = best;
+	}
+	rc->last_update = ticks;
+}
+
+/*
+ * Pick the next rate which may give better throughput than
+ * the current one.
+ */
+static uint8_t
+rtwn_rc_sample(struct rtwn_rc_node *rc)
+{
+	uint32_t cur_tp;
+	uint8_t ridx;
+	int i;
+
+	cur_tp = rc->st[rc->cur].tp;
+	for (i = 0; i < RTWN_STATS_NRATES; i++) {
+		ridx = (rc->sample + 1 + i) % RTWN_STATS_NRATES;
+		if (ridx == rc->cur || (rc->rates & (1 << ridx)) == 0)
+			continue;
+		if (rtwn_rc_tp(ridx, RTWN_RC_PROB_ONE) <= cur_tp)
+			continue;
+
+		rc->sample = ridx;
+		return (ridx);
+	}
+
+	return (RTWN_RIDX_UNKNOWN);
+}
+
+void
+rtwn_rc_reset(struct rtwn_node *un)
+{
+	atomic_store_rel_int(&un->rc.reset, 1);
+}
+
+uint8_t
+rtwn_rc_rate(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    int *maxretry)
+{
+	struct rtwn_rc_node *rc = &RTWN_NODE(ni)->rc;
+	uint8_t ridx, sample;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (rc->rates == 0 ||
+	    (rc->reset != 0 && atomic_readandclear_int(&rc->reset) != 0))
+		rtwn_rc_init(sc, ni);
+	else if (ticks - rc->last_update >= RTWN_RC_INTERVAL)
+		rtwn_rc_update(sc, rc);
+
+	ridx = rc->cur;
+	if (++rc->nframes >= RTWN_RC_SAMPLE_RATIO) {
+		rc->nframes = 0;
+		sample = rtwn_rc_sample(rc);
+		if (sample != RTWN_RIDX_UNKNOWN) {
+			/* Do not waste airtime on retries. */
+			ridx = sample;
+			*maxretry = MIN(*maxretry, RTWN_RC_SAMPLE_RETRY);
+			rc->probe = 1;
+		}
+	}
+
+	if (ridx >= RTWN_RIDX_MCS(0))
+		ni->ni_txrate = IEEE80211_RATE_MCS | (ridx - RTWN_RIDX_MCS(0));
+	else
+		ni->ni_txrate = ridx2rate[ridx];
+
+	return (ni->ni_txrate);
+}
+
+/*
+ * Called after the frame was handed to the bus; if it requested
+ * a Tx report, remember the rate until the report arrives.
+ */
+void
+rtwn_rc_tx_submit(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    int error)
+{
+	struct rtwn_rc_node *rc = &RTWN_NODE(ni)->rc;
+	int i, probe;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (rc->pending_w == 0)
+		return;
+
+	probe = rc->probe;
+	rc->probe = 0;
+	if (error != 0) {
+		/* No report will come for this frame. */
+		rc->pending_w = 0;
+		return;
+	}
+
+	if (rc->final_rate) {
+		/* The report has the final rate; only probes are tracked. */
+		if (probe)
+			rc->probe_ridx = rc->pending;
+		rc->pending_w = 0;
+		return;
+	}
+
+	if (rc->fifo_len == RTWN_RC_FIFO) {
+		/* Report was lost; drop the oldest entry. */
+		rc->fifo_head = (rc->fifo_head + 1) % RTWN_RC_FIFO;
+		rc->fifo_len--;
+	}
+	i = (rc->fifo_head + rc->fifo_len) % RTWN_RC_FIFO;
+	rc->fifo[i] = rc->pending;
+	rc->fifo_w[i] = rc->pending_w;
+	rc->fifo_len++;
+	rc->pending_w = 0;
+}
+
+/*
+ * Account a Tx report; final_ridx is RTWN_RIDX_UNKNOWN when the
+ * chip does not provide it.
+ */
+void
+rtwn_rc_tx_complete(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    int ntries, int success, uint8_t final_ridx)
+{
+	struct rtwn_rc_node *rc = &RTWN_NODE(ni)->rc;
+	uint8_t ridx;
+	int w;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (rc->rates == 0)
+		return;
+
+	if (final_ridx < RTWN_STATS_NRATES &&
+	    (rc->rates & (1 << final_ridx)) != 0) {
+		/*
+		 * The chip reports the final rate; the initial one was
+		 * either the last queued probe or the current rate.
+		 */
+		rc->final_rate = 1;
+		rc->fifo_len = 0;
+		if (rc->probe_ridx != RTWN_RIDX_UNKNOWN) {
+			ridx = rc->probe_ridx;
+			w = 1;
+			rc->probe_ridx = RTWN_RIDX_UNKNOWN;
+		} else {
+			ridx = rc->cur;
+			w = RTWN_NODE(ni)->rpt_ival;
+		}
+	} else if (rc->fifo_len != 0) {
+		ridx = rc->fifo[rc->fifo_head];
+		w = rc->fifo_w[rc->fifo_head];
+		rc->fifo_head = (rc->fifo_head + 1) % RTWN_RC_FIFO;
+		rc->fifo_len--;
+	} else {
+		ridx = rc->cur;
+		w = 1;
+	}
+	if (ridx >= RTWN_STATS_NRATES || (rc->rates & (1 << ridx)) == 0)
+		return;		/* not a data rate */
+
+	if (final_ridx < RTWN_STATS_NRATES && final_ridx != ridx &&
+	    (rc->rates & (1 << final_ridx)) != 0) {
+		/* H/w fallback was used; the initial rate did not work. */
+		rc->st[ridx].attempts += w;
+		rc->st[final_ridx].attempts += w;
+		if (success)
+			rc->st[final_ridx].success += w;
+	} else {
+		rc->st[ridx].attempts += (ntries + 1) * w;
+		if (success)
+			rc->st[ridx].success += w;
+	}
+}
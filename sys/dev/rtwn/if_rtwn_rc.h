@@ -0,0 +1,45 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef IF_RTWN_RC_H
+#define IF_RTWN_RC_H
+
+#define RTWN_RC_PROB_ONE	1024
+#define RTWN_RC_PROB_MIN	(RTWN_RC_PROB_ONE / 10)
+#define RTWN_RC_INTERVAL	MAX(1, hz / 10)
+#define RTWN_RC_SAMPLE_RATIO	16	/* 1 probe per N frames */
+#define RTWN_RC_SAMPLE_RETRY	1	/* retry limit for probes */
+
+void	rtwn_rc_reset(struct rtwn_node *);
+uint8_t	rtwn_rc_rate(struct rtwn_softc *, struct ieee80211_node *, int *);
+void	rtwn_rc_tx_submit(struct rtwn_softc *, struct ieee80211_node *,
+	    int);
+void	rtwn_rc_tx_complete(struct rtwn_softc *, struct ieee80211_node *,
+	    int, int, uint8_t);
+
+#endif	/* IF_RTWN_RC_H */
@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -49,8 +50,12 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_ps.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
 #include <dev/rtwn/if_rtwn_rx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
+#include <dev/rtwn/if_rtwn_tsf.h>
 
 #include <dev/rtwn/rtl8192c/r92c_reg.h>
 #include <dev/rtwn/rtl8192c/r92c_rx_desc.h>
@@ -167,27 +172,6 @@ rtwn_get_rssi(struct rtwn_softc *sc, int rate, void *physt)
 	return (rssi);
 }
 
-static uint32_t
-rtwn_get_tsf_low(struct rtwn_softc *sc, int id)
-{
-	return (rtwn_read_4(sc, R92C_TSFTR(id)));
-}
-
-static uint32_t
-rtwn_get_tsf_high(struct rtwn_softc *sc, int id)
-{
-	return (rtwn_read_4(sc, R92C_TSFTR(id) + 4));
-}
-
-static void
-rtwn_get_tsf(struct rtwn_softc *sc, uint64_t *buf, int id)
-{
-	/* NB: we cannot read it at once. */
-	*buf = rtwn_get_tsf_high(sc, id);
-	*buf <<= 32;
-	*buf += rtwn_get_tsf_low(sc, id);
-}
-
 struct ieee80211_node *
 rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
     int8_t *rssi)
@@ -203,6 +187,8 @@ rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
 	stat = desc;
 	rxdw0 = le32toh(stat->rxdw0);
 	rxdw3 = le32toh(stat->rxdw3);
+	RTWN_TRACE(sc, RX_DESC, rx__desc, rxdw0, le32toh(stat->rxdw1),
+	    le32toh(stat->rxdw2), rxdw3);
 
 	cipher = MS(rxdw0, R92C_RXDW0_CIPHER);
 	infosz = MS(rxdw0, R92C_RXDW0_INFOSZ) * 8;
@@ -215,7 +201,11 @@ rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
 	    cipher != R92C_CAM_ALGO_NONE)
 		m->m_flags |= M_WEP;
 
-	if (pktlen >= sizeof(*wh))
+	/*
+	 * NB: monitor mode vaps do not use node table; skip the lookup
+	 * (frames will be passed via ieee80211_input_all()).
+	 */
+	if (pktlen >= sizeof(*wh) && !RTWN_MONITOR_ONLY(sc))
 		ni = ieee80211_find_rxnode(ic, wh);
 	else
 		ni = NULL;
@@ -233,10 +223,18 @@ rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
 
 			/* Update our average RSSI. */
 			rtwn_update_avgrssi(sc, un, rate);
+			rtwn_stats_rssi(un, *rssi);
 		}
 	} else
 		*rssi = (un != NULL) ? un->last_rssi : sc->last_rssi;
 
+	if (un != NULL) {
+		rtwn_stats_rx(un, rate, pktlen);
+		if ((wh->i_fc[0] & IEEE80211_FC0_TYPE_MASK) ==
+		    IEEE80211_FC0_TYPE_DATA)
+			rtwn_ps_traffic(sc);
+	}
+
 	if (ieee80211_radiotap_active(ic)) {
 		struct rtwn_rx_radiotap_header *tap = &sc->sc_rxtap;
 		int id = RTWN_VAP_ID_INVALID;
@@ -247,11 +245,8 @@ rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
 			id = 0;
 
 		tap->wr_flags = rtwn_rx_radiotap_flags(sc, desc);
-		tap->wr_tsft = rtwn_get_tsf_high(sc, id);
-		if (le32toh(stat->tsf_low) > rtwn_get_tsf_low(sc, id))
-			tap->wr_tsft--;
-		tap->wr_tsft = (uint64_t)htole32(tap->wr_tsft) << 32;
-		tap->wr_tsft += stat->tsf_low;
+		tap->wr_tsft = htole64(rtwn_tsf_extend(sc, id,
+		    le32toh(stat->tsf_low)));
 
 		/* XXX 20/40? */
 
@@ -271,6 +266,78 @@ rtwn_rx_common(struct rtwn_softc *sc, struct mbuf *m, void *desc,
 	return (ni);
 }
 
+/*
+ * Monitor mode fast path (RTWN_MONITOR_ONLY()): no node lookups and
+ * no per-node statistics; radiotap fields are saved into 'mon' and
+ * copied into the shared header by rtwn_rx_monitor_tap() right before
+ * the frame is passed to net80211, so a whole batch of frames can be
+ * prepared with a single lock hold.  '*tsf' is the extended TSF of
+ * the first frame in the aggregate (0 - not known yet); other frames
+ * are extended relative to it.
+ */
+void
+rtwn_rx_monitor(struct rtwn_softc *sc, struct mbuf *m, void *desc,
+    struct rtwn_rx_mon *mon, uint64_t *tsf)
+{
+	struct ieee80211_frame_min *wh;
+	struct r92c_rx_stat *stat;
+	uint32_t rxdw0, rxdw3, tsf_low;
+	int cipher, infosz, rate, shift;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	stat = desc;
+	rxdw0 = le32toh(stat->rxdw0);
+	rxdw3 = le32toh(stat->rxdw3);
+	RTWN_TRACE(sc, RX_DESC, rx__desc, rxdw0, le32toh(stat->rxdw1),
+	    le32toh(stat->rxdw2), rxdw3);
+
+	cipher = MS(rxdw0, R92C_RXDW0_CIPHER);
+	infosz = MS(rxdw0, R92C_RXDW0_INFOSZ) * 8;
+	shift = MS(rxdw0, R92C_RXDW0_SHIFT);
+	rate = MS(rxdw3, R92C_RXDW3_RATE);
+
+	wh = (struct ieee80211_frame_min *)(mtodo(m, shift + infosz));
+	if ((wh->i_fc[1] & IEEE80211_FC1_PROTECTED) &&
+	    cipher != R92C_CAM_ALGO_NONE)
+		m->m_flags |= M_WEP;
+
+	if (infosz != 0 && (rxdw0 & R92C_RXDW0_PHYST)) {
+		mon->rssi = rtwn_get_rssi(sc, rate, mtod(m, void *));
+		sc->last_rssi = mon->rssi;
+	} else
+		mon->rssi = sc->last_rssi;
+
+	mon->flags = rtwn_rx_radiotap_flags(sc, desc);
+	mon->rate = rate;
+
+	tsf_low = le32toh(stat->tsf_low);
+	if (*tsf == 0)
+		*tsf = rtwn_tsf_extend(sc, 0, tsf_low);
+	mon->tsft = *tsf + (int32_t)(tsf_low - (uint32_t)*tsf);
+
+	/* Drop PHY descriptor. */
+	m_adj(m, infosz + shift);
+}
+
+void
+rtwn_rx_monitor_tap(struct rtwn_softc *sc, const struct rtwn_rx_mon *mon)
+{
+	struct rtwn_rx_radiotap_header *tap = &sc->sc_rxtap;
+
+	tap->wr_flags = mon->flags;
+	tap->wr_tsft = htole64(mon->tsft);
+
+	/* Map HW rate index to 802.11 rate. */
+	if (mon->rate < RTWN_RIDX_MCS(0))
+		tap->wr_rate = ridx2rate[mon->rate];
+	else	/* MCS0~15. */
+		tap->wr_rate = IEEE80211_RATE_MCS | (mon->rate - 12);
+
+	tap->wr_dbm_antsignal = mon->rssi;
+	tap->wr_dbm_antnoise = RTWN_NOISE_FLOOR;
+}
+
 void
 rtwn_adhoc_recv_mgmt(struct ieee80211_node *ni, struct mbuf *m, int subtype,
     const struct ieee80211_rx_stats *rxs,
@@ -21,12 +21,22 @@
 
 #define	RTWN_NOISE_FLOOR	-95
 
+/* Radiotap data saved by the monitor mode fast path. */
+struct rtwn_rx_mon {
+	uint64_t	tsft;
+	int8_t		rssi;
+	uint8_t		flags;
+	uint8_t		rate;
+};
 
 void	rtwn_get_rates(struct rtwn_softc *, const struct ieee80211_rateset *,
 	    const struct ieee80211_htrateset *, uint32_t *, int *, int);
 void	rtwn_set_basicrates(struct rtwn_softc *, uint32_t);
 struct ieee80211_node *	rtwn_rx_common(struct rtwn_softc *, struct mbuf *,
 	    void *, int8_t *);
+void	rtwn_rx_monitor(struct rtwn_softc *, struct mbuf *, void *,
+	    struct rtwn_rx_mon *, uint64_t *);
+void	rtwn_rx_monitor_tap(struct rtwn_softc *, const struct rtwn_rx_mon *);
 void	rtwn_adhoc_recv_mgmt(struct ieee80211_node *, struct mbuf *, int,
 	    const struct ieee80211_rx_stats *, int, int);
 void	rtwn_set_multi(struct rtwn_softc *);
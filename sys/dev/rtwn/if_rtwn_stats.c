@@ -0,0 +1,354 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include "opt_wlan.h"
+
+#include <sys/param.h>
+#include <sys/sysctl.h>
+#include <sys/sbuf.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/mbuf.h>
+#include <sys/kernel.h>
+#include <sys/socket.h>
+#include <sys/systm.h>
+#include <sys/malloc.h>
+#include <sys/pcpu.h>
+#include <sys/queue.h>
+#include <sys/taskqueue.h>
+#include <sys/bus.h>
+#include <sys/endian.h>
+
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_media.h>
+
+#include <net80211/ieee80211_var.h>
+#include <net80211/ieee80211_radiotap.h>
+
+#include <dev/rtwn/if_rtwnvar.h>
+
+#include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+
+CTASSERT(RTWN_STATS_NRATES == RTWN_RIDX_COUNT);
+
+/* MCS0-7 PHY rates (20 MHz, long GI), in 100 kbps units. */
+static const uint16_t rtwn_mcs_rate[] =
+	{ 65, 130, 195, 260, 390, 520, 585, 650 };
+
+struct rtwn_node_stats_rec {
+	int			id;
+	uint8_t			macaddr[IEEE80211_ADDR_LEN];
+	int			avg_pwdb;
+	struct rtwn_node_stats	stats;
+};
+
+static const char *rtwn_regacct_names[RTWN_REGACCT_MAX] = {
+	"other", "init", "chan", "calib", "cam", "beacon", "rx", "tx", "fw"
+};
+
+static int	rtwn_regacct_tag(struct rtwn_softc *);
+static int	rtwn_sysctl_node_stats(SYSCTL_HANDLER_ARGS);
+static int	rtwn_sysctl_reg_stats(SYSCTL_HANDLER_ARGS);
+static int	rtwn_sysctl_reg_stats_reset(SYSCTL_HANDLER_ARGS);
+
+
+/*
+ * Rough estimate (PLCP header + payload; HT40 / short GI / aggregation
+ * are not taken into account).
+ */
+uint32_t
+rtwn_stats_airtime(uint8_t ridx, int len)
+{
+	uint32_t rate, plcp;
+	int mcs;
+
+	if (RTWN_RATE_IS_CCK(ridx)) {
+		rate = ridx2rate[ridx] * 5;
+		plcp = 192;
+	} else if (ridx < RTWN_RIDX_MCS(0)) {
+		rate = ridx2rate[ridx] * 5;
+		plcp = 20;
+	} else if (ridx < RTWN_RIDX_COUNT) {
+		mcs = ridx - RTWN_RIDX_MCS(0);
+		rate = rtwn_mcs_rate[mcs % 8] * (mcs / 8 + 1);
+		plcp = 36;
+	} else
+		return (0);
+
+	return (plcp + len * 80 / rate);
+}
+
+static void
+rtwn_stats_print_rate(struct sbuf *sb, int ridx)
+{
+	if (ridx >= RTWN_RIDX_MCS(0))
+		sbuf_printf(sb, "MCS%d", ridx - RTWN_RIDX_MCS(0));
+	else if (ridx2rate[ridx] % 2 != 0)
+		sbuf_printf(sb, "%d.5M", ridx2rate[ridx] / 2);
+	else
+		sbuf_printf(sb, "%dM", ridx2rate[ridx] / 2);
+}
+
+static int
+rtwn_sysctl_node_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct rtwn_node_stats_rec *recs, *rec;
+	struct rtwn_node_stats *st;
+	struct ieee80211_node *ni;
+	struct sbuf sb;
+	int error, i, j, n;
+
+	/* Take a snapshot; sysctl output may sleep. */
+	recs = malloc(sizeof(*recs) * RTWN_MACID_LIMIT, M_TEMP,
+	    M_WAITOK | M_ZERO);
+	n = 0;
+	RTWN_LOCK(sc);		/* Rx / Tx counters */
+	RTWN_NT_LOCK(sc);
+	for (i = 0; i < RTWN_MACID_LIMIT && i <= sc->macid_limit; i++) {
+		ni = sc->node_list[i];
+		if (ni == NULL)
+			continue;
+
+		rec = &recs[n++];
+		rec->id = i;
+		IEEE80211_ADDR_COPY(rec->macaddr, ni->ni_macaddr);
+		rec->avg_pwdb = RTWN_NODE(ni)->avg_pwdb;
+		rec->stats = RTWN_NODE(ni)->stats;
+	}
+	RTWN_NT_UNLOCK(sc);
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 256, req);
+	for (i = 0; i < n; i++) {
+		rec = &recs[i];
+		st = &rec->stats;
+
+		sbuf_printf(&sb, "\nmacid %d (%6D): rssi %d dBm, pwdb %d\n",
+		    rec->id, rec->macaddr, ":", st->rssi_ema / 16,
+		    rec->avg_pwdb);
+		sbuf_printf(&sb, "  rx: %ju packets, %ju bytes, %ju us\n",
+		    (uintmax_t)st->rx_packets, (uintmax_t)st->rx_bytes,
+		    (uintmax_t)st->rx_airtime);
+		sbuf_printf(&sb, "  tx: %ju packets, %ju bytes, %ju us\n",
+		    (uintmax_t)st->tx_packets, (uintmax_t)st->tx_bytes,
+		    (uintmax_t)st->tx_airtime);
+		sbuf_printf(&sb,
+		    "  tx status: %ju reports, %ju retries, %ju failed "
+		    "(%d%% recently)\n",
+		    (uintmax_t)st->tx_reports, (uintmax_t)st->tx_retries,
+		    (uintmax_t)st->tx_failed,
+		    st->tx_per * 100 / RTWN_STATS_PER_ONE);
+		if (st->ampdu_count != 0) {
+			sbuf_printf(&sb, "  ampdu: %ju subframes, %ju bytes, "
+			    "~%ju aggregates (%ju subframes / %ju bytes avg), "
+			    "limit %d, density %d\n",
+			    (uintmax_t)st->ampdu_mpdus,
+			    (uintmax_t)st->ampdu_bytes,
+			    (uintmax_t)st->ampdu_count,
+			    (uintmax_t)(st->ampdu_mpdus / st->ampdu_count),
+			    (uintmax_t)(st->ampdu_bytes / st->ampdu_count),
+			    st->ampdu_maxagg, st->ampdu_density);
+		}
+		sbuf_printf(&sb, "  rx rates:");
+		for (j = 0; j < RTWN_STATS_NRATES; j++) {
+			if (st->rx_rate[j] == 0)
+				continue;
+
+			sbuf_printf(&sb, " ");
+			rtwn_stats_print_rate(&sb, j);
+			sbuf_printf(&sb, ":%u", st->rx_rate[j]);
+		}
+		sbuf_printf(&sb, "\n");
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	free(recs, M_TEMP);
+
+	return (error);
+}
+
+/*
+ * Set the accounting tag for the current thread; returns the previous
+ * one (RTWN_REGACCT_NONE if there was none).  When all slots are busy
+ * the accesses are accounted as 'other'.
+ */
+int
+rtwn_regacct_set(struct rtwn_softc *sc, int tag)
+{
+	struct rtwn_regacct_owner *o, *slot;
+	int i, prev;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	slot = NULL;
+	for (i = 0; i < RTWN_REGACCT_OWNERS; i++) {
+		o = &sc->sc_regacct_owner[i];
+		if (o->td == curthread) {
+			prev = o->tag;
+			o->tag = tag;
+			return (prev);
+		}
+		if (o->td == NULL && slot == NULL)
+			slot = o;
+	}
+	if (slot != NULL) {
+		slot->td = curthread;
+		slot->tag = tag;
+	}
+
+	return (RTWN_REGACCT_NONE);
+}
+
+void
+rtwn_regacct_restore(struct rtwn_softc *sc, int prev)
+{
+	struct rtwn_regacct_owner *o;
+	int i;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	for (i = 0; i < RTWN_REGACCT_OWNERS; i++) {
+		o = &sc->sc_regacct_owner[i];
+		if (o->td != curthread)
+			continue;
+
+		if (prev == RTWN_REGACCT_NONE)
+			o->td = NULL;
+		else
+			o->tag = prev;
+		break;
+	}
+}
+
+static int
+rtwn_regacct_tag(struct rtwn_softc *sc)
+{
+	int i;
+
+	for (i = 0; i < RTWN_REGACCT_OWNERS; i++)
+		if (sc->sc_regacct_owner[i].td == curthread)
+			return (sc->sc_regacct_owner[i].tag);
+
+	return (RTWN_REGACCT_OTHER);
+}
+
+/*
+ * Account a register access (or a region transfer); called by the bus
+ * code when dev.rtwn.N.regacct is set.
+ */
+void
+rtwn_stats_reg(struct rtwn_softc *sc, int write, int len, int retries,
+    sbintime_t sbt)
+{
+	struct rtwn_regacct *ra;
+
+	ra = &sc->sc_regacct[rtwn_regacct_tag(sc)];
+	if (write)
+		ra->writes++;
+	else
+		ra->reads++;
+	ra->bytes += len;
+	ra->retries += retries;
+	ra->usec += sbttous(sbt);
+}
+
+static int
+rtwn_sysctl_reg_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct rtwn_regacct ra[RTWN_REGACCT_MAX];
+	struct sbuf sb;
+	int error, i;
+
+	RTWN_LOCK(sc);
+	memcpy(ra, sc->sc_regacct, sizeof(ra));
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 256, req);
+	for (i = 0; i < RTWN_REGACCT_MAX; i++) {
+		if (ra[i].reads == 0 && ra[i].writes == 0)
+			continue;
+
+		sbuf_printf(&sb, "\n%-7s %ju reads, %ju writes, %ju bytes, "
+		    "%ju retries, %ju us", rtwn_regacct_names[i],
+		    (uintmax_t)ra[i].reads, (uintmax_t)ra[i].writes,
+		    (uintmax_t)ra[i].bytes, (uintmax_t)ra[i].retries,
+		    (uintmax_t)ra[i].usec);
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
+
+static int
+rtwn_sysctl_reg_stats_reset(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	int error, val;
+
+	val = 0;
+	error = sysctl_handle_int(oidp, &val, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+
+	if (val != 0) {
+		RTWN_LOCK(sc);
+		memset(sc->sc_regacct, 0, sizeof(sc->sc_regacct));
+		RTWN_UNLOCK(sc);
+	}
+
+	return (0);
+}
+
+void
+rtwn_stats_sysctlattach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "node_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_sysctl_node_stats, "A", "Per-node link statistics");
+
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "regacct", CTLFLAG_RWTUN, &sc->sc_regacct_enable,
+	    sc->sc_regacct_enable, "Enable register access accounting");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "reg_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    rtwn_sysctl_reg_stats, "A",
+	    "Register accesses per subsystem");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "reg_stats_reset", CTLTYPE_INT | CTLFLAG_WR | CTLFLAG_MPSAFE, sc,
+	    0, rtwn_sysctl_reg_stats_reset, "I",
+	    "Reset register access statistics");
+}
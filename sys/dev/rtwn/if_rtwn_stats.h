@@ -0,0 +1,101 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef IF_RTWN_STATS_H
+#define IF_RTWN_STATS_H
+
+void		rtwn_stats_sysctlattach(struct rtwn_softc *);
+void		rtwn_stats_reg(struct rtwn_softc *, int, int, int, sbintime_t);
+uint32_t	rtwn_stats_airtime(uint8_t, int);
+
+static __inline void
+rtwn_stats_rx(struct rtwn_node *un, uint8_t ridx, int len)
+{
+	struct rtwn_node_stats *st = &un->stats;
+
+	st->rx_packets++;
+	st->rx_bytes += len;
+	st->rx_airtime += rtwn_stats_airtime(ridx, len);
+	if (ridx < RTWN_STATS_NRATES)
+		st->rx_rate[ridx]++;
+}
+
+static __inline void
+rtwn_stats_rssi(struct rtwn_node *un, int8_t rssi)
+{
+	struct rtwn_node_stats *st = &un->stats;
+
+	/* EMA with 1/8 weight. */
+	if (st->rssi_ema == 0)
+		st->rssi_ema = rssi * 16;
+	else
+		st->rssi_ema += (rssi * 16 - st->rssi_ema) / 8;
+}
+
+static __inline void
+rtwn_stats_tx(struct rtwn_node *un, uint8_t ridx, int len)
+{
+	struct rtwn_node_stats *st = &un->stats;
+
+	st->tx_packets++;
+	st->tx_bytes += len;
+	st->tx_airtime += rtwn_stats_airtime(ridx, len);
+}
+
+static __inline void
+rtwn_stats_tx_status(struct rtwn_node *un, int ntries, int success)
+{
+	struct rtwn_node_stats *st = &un->stats;
+
+	st->tx_reports++;
+	st->tx_retries += ntries;
+	if (!success)
+		st->tx_failed++;
+
+	/* EMA with 1/8 weight. */
+	st->tx_per += ((success ? 0 : RTWN_STATS_PER_ONE) - st->tx_per) / 8;
+}
+
+static __inline void
+rtwn_stats_tx_ampdu(struct rtwn_node *un, int tid, int len, int maxagg)
+{
+	struct rtwn_node_stats *st = &un->stats;
+
+	/* Assume that the h/w fills an aggregate up to the limit. */
+	if (st->ampdu_open == 0 || st->ampdu_open >= maxagg ||
+	    st->ampdu_tid != tid) {
+		st->ampdu_count++;
+		st->ampdu_open = 0;
+		st->ampdu_tid = tid;
+	}
+	st->ampdu_open++;
+	st->ampdu_mpdus++;
+	st->ampdu_bytes += len;
+}
+
+#endif	/* IF_RTWN_STATS_H */
@@ -28,6 +28,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -42,6 +43,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_task.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 
 
 static void
@@ -63,6 +65,8 @@ rtwn_cmdq_cb(void *arg, int pending)
 	RTWN_CMDQ_LOCK(sc);
 	while (sc->cmdq[sc->cmdq_first].func != NULL) {
 		item = &sc->cmdq[sc->cmdq_first];
+		RTWN_TRACE(sc, CMD_DEQ, cmd__deq, sc->cmdq_first,
+		    (uint32_t)(uintptr_t)item->func, 0, 0);
 		sc->cmdq_first = (sc->cmdq_first + 1) % RTWN_CMDQ_SIZE;
 		RTWN_CMDQ_UNLOCK(sc);
 
@@ -113,6 +117,8 @@ rtwn_cmd_sleepable(struct rtwn_softc *sc, const void *ptr, size_t len,
 	if (ptr != NULL)
 		memcpy(&sc->cmdq[sc->cmdq_last].data, ptr, len);
 	sc->cmdq[sc->cmdq_last].func = func;
+	RTWN_TRACE(sc, CMD_ENQ, cmd__enq, sc->cmdq_last,
+	    (uint32_t)(uintptr_t)func, 0, 0);
 	sc->cmdq_last = (sc->cmdq_last + 1) % RTWN_CMDQ_SIZE;
 	RTWN_CMDQ_UNLOCK(sc);
 
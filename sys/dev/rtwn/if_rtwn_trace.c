@@ -0,0 +1,206 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Binary event trace.
+ *
+ * Writers reserve a slot with a single atomic increment and never block;
+ * a record is marked invalid while it is being filled, so readers skip
+ * records which were overwritten during the snapshot.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include "opt_wlan.h"
+
+#include <sys/param.h>
+#include <sys/sysctl.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/mbuf.h>
+#include <sys/kernel.h>
+#include <sys/socket.h>
+#include <sys/systm.h>
+#include <sys/malloc.h>
+#include <sys/pcpu.h>
+#include <sys/queue.h>
+#include <sys/sdt.h>
+#include <sys/taskqueue.h>
+#include <sys/bus.h>
+#include <sys/endian.h>
+
+#include <machine/atomic.h>
+
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_media.h>
+
+#include <net80211/ieee80211_var.h>
+#include <net80211/ieee80211_radiotap.h>
+
+#include <dev/rtwn/if_rtwnvar.h>
+
+#include <dev/rtwn/if_rtwn_trace.h>
+
+/* NB: arguments are declared as they are stored in the ring. */
+SDT_PROVIDER_DEFINE(rtwn);
+SDT_PROBE_DEFINE5(rtwn, , , rx__desc, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , tx__enq, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , tx__done, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , reg__write, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , cmd__enq, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , cmd__deq, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE5(rtwn, , , intr, "struct rtwn_softc *",
+    "uint32_t", "uint32_t", "uint32_t", "uint32_t");
+
+static int	rtwn_sysctl_trace(SYSCTL_HANDLER_ARGS);
+
+
+void
+rtwn_trace_init(struct rtwn_softc *sc)
+{
+	sc->sc_trace = malloc(sizeof(*sc->sc_trace) * RTWN_TRACE_SIZE,
+	    M_DEVBUF, M_WAITOK);
+	memset(sc->sc_trace, 0xff, sizeof(*sc->sc_trace) * RTWN_TRACE_SIZE);
+	sc->sc_trace_head = 0;
+}
+
+/*
+ * Stop recording and remove the sysctl (waits for running handlers).
+ */
+void
+rtwn_trace_detach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+
+	sc->sc_trace_mask = 0;
+	if (sc->sc_trace_oid != NULL) {
+		sysctl_ctx_entry_del(ctx, sc->sc_trace_oid);
+		sysctl_remove_oid(sc->sc_trace_oid, 1, 0);
+		sc->sc_trace_oid = NULL;
+	}
+}
+
+/*
+ * NB: must be called after all event sources (interrupt handler,
+ * USB transfers, tasks) were stopped.
+ */
+void
+rtwn_trace_free(struct rtwn_softc *sc)
+{
+	sc->sc_trace_mask = 0;
+	if (sc->sc_trace != NULL) {
+		free(sc->sc_trace, M_DEVBUF);
+		sc->sc_trace = NULL;
+	}
+}
+
+void
+rtwn_trace_record(struct rtwn_softc *sc, int type, uint32_t a0,
+    uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	struct rtwn_trace_rec *rec;
+	u_int seq;
+
+	if (sc->sc_trace == NULL)
+		return;
+
+	seq = atomic_fetchadd_int(&sc->sc_trace_head, 1);
+	if (__predict_false(seq == RTWN_TRACE_SEQ_INVALID))
+		seq = atomic_fetchadd_int(&sc->sc_trace_head, 1);
+	rec = &sc->sc_trace[seq & (RTWN_TRACE_SIZE - 1)];
+
+	atomic_store_32(&rec->seq, RTWN_TRACE_SEQ_INVALID);
+	/* Invalidate the record before the payload is changed. */
+	atomic_thread_fence_rel();
+	rec->ts = sbinuptime();
+	rec->type = type;
+	rec->cpu = curcpu;
+	rec->arg[0] = a0;
+	rec->arg[1] = a1;
+	rec->arg[2] = a2;
+	rec->arg[3] = a3;
+	atomic_store_rel_32(&rec->seq, seq);
+}
+
+static int
+rtwn_sysctl_trace(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct rtwn_trace_rec *recs, *rec;
+	u_int head, seq;
+	int error, n;
+
+	if (sc->sc_trace == NULL)
+		return (ENXIO);
+
+	recs = malloc(sizeof(*recs) * RTWN_TRACE_SIZE, M_TEMP, M_WAITOK);
+	head = atomic_load_acq_int(&sc->sc_trace_head);
+	/* NB: unused / stale slots are skipped by the seq check below. */
+	seq = head - RTWN_TRACE_SIZE;
+	for (n = 0; seq != head; seq++) {
+		if (seq == RTWN_TRACE_SEQ_INVALID)
+			continue;	/* never used */
+
+		rec = &sc->sc_trace[seq & (RTWN_TRACE_SIZE - 1)];
+		if (atomic_load_acq_32(&rec->seq) != seq)
+			continue;	/* being written or overwritten */
+
+		recs[n] = *rec;
+		/* Finish the copy before the record is re-checked. */
+		atomic_thread_fence_acq();
+		if (atomic_load_32(&rec->seq) == seq)
+			n++;
+	}
+
+	error = SYSCTL_OUT(req, recs, sizeof(*recs) * n);
+	free(recs, M_TEMP);
+
+	return (error);
+}
+
+void
+rtwn_trace_sysctlattach(struct rtwn_softc *sc)
+{
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "trace_mask", CTLFLAG_RWTUN, &sc->sc_trace_mask,
+	    sc->sc_trace_mask, "Mask of traced events (see if_rtwn_trace.h)");
+	sc->sc_trace_oid = SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree),
+	    OID_AUTO, "trace", CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_MPSAFE,
+	    sc, 0,
+	    rtwn_sysctl_trace, "S,rtwn_trace_rec",
+	    "Event trace (struct rtwn_trace_rec records)");
+}
@@ -0,0 +1,91 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef IF_RTWN_TRACE_H
+#define IF_RTWN_TRACE_H
+
+/*
+ * Event types (bit numbers in dev.rtwn.N.trace_mask) and
+ * their arguments.
+ */
+enum {
+	RTWN_TRACE_RX_DESC,	/* rxdw0, rxdw1, rxdw2, rxdw3 */
+	RTWN_TRACE_TX_ENQ,	/* macid, ridx, length, frame type */
+	RTWN_TRACE_TX_DONE,	/* macid, retries, success, final ridx */
+	RTWN_TRACE_REG_WRITE,	/* address, value, length */
+	RTWN_TRACE_CMD_ENQ,	/* slot, function (low 32 bits) */
+	RTWN_TRACE_CMD_DEQ,	/* slot, function (low 32 bits) */
+	RTWN_TRACE_INTR,	/* status, Tx rings */
+	RTWN_TRACE_MAX
+};
+
+/*
+ * Record layout, as exported via dev.rtwn.N.trace
+ * (oldest record first).
+ */
+struct rtwn_trace_rec {
+	uint64_t	ts;		/* sbinuptime() */
+	uint32_t	seq;
+	uint16_t	type;
+	uint16_t	cpu;
+	uint32_t	arg[4];
+};
+
+#define RTWN_TRACE_SIZE		1024	/* records; must be a power of 2 */
+#define RTWN_TRACE_SEQ_INVALID	0xffffffff
+
+#ifdef _KERNEL
+SDT_PROVIDER_DECLARE(rtwn);
+SDT_PROBE_DECLARE(rtwn, , , rx__desc);
+SDT_PROBE_DECLARE(rtwn, , , tx__enq);
+SDT_PROBE_DECLARE(rtwn, , , tx__done);
+SDT_PROBE_DECLARE(rtwn, , , reg__write);
+SDT_PROBE_DECLARE(rtwn, , , cmd__enq);
+SDT_PROBE_DECLARE(rtwn, , , cmd__deq);
+SDT_PROBE_DECLARE(rtwn, , , intr);
+
+/*
+ * Fire the SDT probe and (if enabled) store the event in the ring.
+ */
+#define RTWN_TRACE(_sc, _type, _probe, _a0, _a1, _a2, _a3) do {	\
+	SDT_PROBE5(rtwn, , , _probe, (_sc), (_a0), (_a1), (_a2), (_a3)); \
+	if (__predict_false((_sc)->sc_trace_mask &			\
+	    (1 << RTWN_TRACE_##_type)))					\
+		rtwn_trace_record((_sc), RTWN_TRACE_##_type,		\
+		    (_a0), (_a1), (_a2), (_a3));			\
+} while (0)
+
+void	rtwn_trace_init(struct rtwn_softc *);
+void	rtwn_trace_detach(struct rtwn_softc *);
+void	rtwn_trace_free(struct rtwn_softc *);
+void	rtwn_trace_sysctlattach(struct rtwn_softc *);
+void	rtwn_trace_record(struct rtwn_softc *, int, uint32_t, uint32_t,
+	    uint32_t, uint32_t);
+#endif	/* _KERNEL */
+
+#endif	/* IF_RTWN_TRACE_H */
@@ -0,0 +1,202 @@
+/*	$OpenBSD: if_urtwn.c,v 1.16 2011/02/10 17:26:40 jakemsr Exp $	*/
+
+/*-
+ * Copyright (c) 2010 Damien Bergamini <damien.bergamini@free.fr>
+ * Copyright (c) 2014 Kevin Lo <kevlo@FreeBSD.org>
+ * Copyright (c) 2015-2016 Andriy Voskoboinyk <avos@FreeBSD.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*-
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include "opt_wlan.h"
+
+#include <sys/param.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/mbuf.h>
+#include <sys/kernel.h>
+#include <sys/socket.h>
+#include <sys/systm.h>
+#include <sys/malloc.h>
+#include <sys/queue.h>
+#include <sys/taskqueue.h>
+#include <sys/bus.h>
+#include <sys/endian.h>
+
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_media.h>
+
+#include <net80211/ieee80211_var.h>
+#include <net80211/ieee80211_radiotap.h>
+
+#include <dev/rtwn/if_rtwnvar.h>
+
+#include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_task.h>
+#include <dev/rtwn/if_rtwn_tsf.h>
+
+#include <dev/rtwn/rtl8192c/r92c_reg.h>
+
+/* Fall back to separate reads when the lower part is about to wrap. */
+#define RTWN_TSF_WRAP_LOW	0xfff00000	/* ~1 s before */
+
+
+static uint32_t
+rtwn_get_tsf_low(struct rtwn_softc *sc, int id)
+{
+	return (rtwn_read_4(sc, R92C_TSFTR(id)));
+}
+
+static uint32_t
+rtwn_get_tsf_high(struct rtwn_softc *sc, int id)
+{
+	return (rtwn_read_4(sc, R92C_TSFTR(id) + 4));
+}
+
+static void
+rtwn_read_tsf(struct rtwn_softc *sc, int id, uint32_t *high, uint32_t *low)
+{
+	uint8_t buf[8];
+
+	/* Both parts are read with a single (bus) transaction... */
+	if (rtwn_read_region(sc, R92C_TSFTR(id), buf, sizeof(buf)) == 0) {
+		*low = le32dec(&buf[0]);
+		*high = le32dec(&buf[4]);
+		if (*low < RTWN_TSF_WRAP_LOW)
+			return;
+	}
+
+	/* ...but the lower part may wrap around in between. */
+	*high = rtwn_get_tsf_high(sc, id);
+	*low = rtwn_get_tsf_low(sc, id);
+	if (rtwn_get_tsf_high(sc, id) != *high) {
+		/* Lower part wrapped around; read it again. */
+		(*high)++;
+		*low = rtwn_get_tsf_low(sc, id);
+	}
+}
+
+void
+rtwn_get_tsf(struct rtwn_softc *sc, uint64_t *buf, int id)
+{
+	uint32_t high, low;
+
+	rtwn_read_tsf(sc, id, &high, &low);
+	*buf = (uint64_t)high << 32 | low;
+}
+
+static void
+rtwn_tsf_sample(struct rtwn_softc *sc, int id)
+{
+	struct rtwn_tsf_est *est = &sc->sc_tsf_est[id];
+	uint32_t high, low;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	rtwn_read_tsf(sc, id, &high, &low);
+	est->sbt = sbinuptime();
+
+	est->tsf = (uint64_t)high << 32 | low;
+	est->valid = 1;
+
+	RTWN_DPRINTF(sc, RTWN_DEBUG_TSF, "%s: port %d, tsf %ju\n",
+	    __func__, id, (uintmax_t)est->tsf);
+}
+
+static void
+rtwn_tsf_sample_cb(struct rtwn_softc *sc, union sec_param *data)
+{
+	int i;
+
+	sc->sc_tsf_pending = 0;
+	for (i = 0; i < RTWN_PORT_COUNT; i++)
+		if (sc->sc_tsf_est[i].valid)
+			rtwn_tsf_sample(sc, i);
+}
+
+void
+rtwn_tsf_est_reset(struct rtwn_softc *sc, int id)
+{
+	RTWN_ASSERT_LOCKED(sc);
+
+	sc->sc_tsf_est[id].valid = 0;
+}
+
+/*
+ * Reconstruct full 64-bit TSF value from the lower part
+ * (as reported in the Rx descriptor).  The upper part is extrapolated
+ * from the last TSF sample; since only the upper 32 bits are taken from
+ * the estimate, its precision is not critical.
+ */
+uint64_t
+rtwn_tsf_extend(struct rtwn_softc *sc, int id, uint32_t tsf_low)
+{
+	struct rtwn_tsf_est *est = &sc->sc_tsf_est[id];
+	sbintime_t now;
+	uint64_t tsf;
+	int32_t delta;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	now = sbinuptime();
+	if (!est->valid) {
+		/* TSF was reset; take a new sample right now. */
+		rtwn_tsf_sample(sc, id);
+	} else if (now - est->sbt > RTWN_TSF_SAMPLE_PERIOD &&
+	    !sc->sc_tsf_pending) {
+		/* Refresh it in background. */
+		if (rtwn_cmd_sleepable(sc, NULL, 0, rtwn_tsf_sample_cb) == 0)
+			sc->sc_tsf_pending = 1;
+	}
+
+	tsf = est->tsf;
+	if (now > est->sbt)
+		tsf += sbttous(now - est->sbt);
+
+	/* Choose the closest value with the same lower part. */
+	delta = (int32_t)(tsf_low - (uint32_t)tsf);
+	if (delta < 0 && tsf < (uint64_t)-(int64_t)delta)
+		return (tsf_low);
+
+	return (tsf + delta);
+}
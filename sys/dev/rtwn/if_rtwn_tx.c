@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -53,7 +54,11 @@ __FBSDID("$FreeBSD$");
 
 #include <dev/rtwn/if_rtwn_beacon.h>
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_ps.h>
+#include <dev/rtwn/if_rtwn_rc.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 #include <dev/rtwn/if_rtwn_tx.h>
 
 
@@ -122,7 +127,7 @@ rtwn_tx_data(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	struct rtwn_tx_buf buf;
 	uint8_t rate, ridx, type;
 	u_int cipher;
-	int ismcast, maxretry;
+	int error, ismcast, maxretry;
 
 	RTWN_ASSERT_LOCKED(sc);
 
@@ -145,10 +150,14 @@ rtwn_tx_data(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	else if (m->m_flags & M_EAPOL)
 		rate = tp->mgmtrate;
 	else {
-		if (sc->sc_ratectl == RTWN_RATECTL_NET80211) {
+		if (sc->sc_ratectl == RTWN_RATECTL_NET80211 ||
+		    (sc->sc_ratectl == RTWN_RATECTL_FW &&
+		     RTWN_NODE_SHARED(RTWN_NODE(ni)))) {
 			/* XXX pass pktlen */
 			(void) ieee80211_ratectl_rate(ni, NULL, 0);
 			rate = ni->ni_txrate;
+		} else if (sc->sc_ratectl == RTWN_RATECTL_DRV) {
+			rate = rtwn_rc_rate(sc, ni, &maxretry);
 		} else {
 			if (ni->ni_flags & IEEE80211_NODE_HT)
 				rate = IEEE80211_RATE_MCS | 0x4; /* MCS4 */
@@ -183,6 +192,13 @@ rtwn_tx_data(struct rtwn_softc *sc, struct ieee80211_node *ni,
 
 	rtwn_fill_tx_desc(sc, ni, m, txd, ridx, maxretry);
 
+	if (!ismcast)
+		rtwn_stats_tx(RTWN_NODE(ni), ridx, m->m_pkthdr.len);
+	if (type == IEEE80211_FC0_TYPE_DATA)
+		rtwn_ps_traffic(sc);
+	RTWN_TRACE(sc, TX_ENQ, tx__enq, RTWN_NODE(ni)->id, ridx,
+	    m->m_pkthdr.len, type);
+
 	if (ieee80211_radiotap_active_vap(vap)) {
 		struct rtwn_tx_radiotap_header *tap = &sc->sc_txtap;
 
@@ -192,7 +208,11 @@ rtwn_tx_data(struct rtwn_softc *sc, struct ieee80211_node *ni,
 		ieee80211_radiotap_tx(vap, m);
 	}
 
-	return (rtwn_tx_start(sc, ni, m, (uint8_t *)txd, type, 0));
+	error = rtwn_tx_start(sc, ni, m, (uint8_t *)txd, type, 0);
+	if (sc->sc_ratectl == RTWN_RATECTL_DRV)
+		rtwn_rc_tx_submit(sc, ni, error);
+
+	return (error);
 }
 
 static int
@@ -230,6 +250,8 @@ rtwn_tx_raw(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	txd->txdw1 = htole32(SM(RTWN_TXDW1_CIPHER, rtwn_get_cipher(cipher)));
 
 	rtwn_fill_tx_desc_raw(sc, ni, m, txd, params);
+	RTWN_TRACE(sc, TX_ENQ, tx__enq, RTWN_NODE(ni)->id,
+	    rate2ridx(params->ibp_rate0), m->m_pkthdr.len, type);
 
 	if (ieee80211_radiotap_active_vap(vap)) {
 		struct rtwn_tx_radiotap_header *tap = &sc->sc_txtap;
@@ -270,8 +292,13 @@ rtwn_start(struct rtwn_softc *sc)
 {
 	struct ieee80211_node *ni;
 	struct mbuf *m;
+	int tag;
 
 	RTWN_ASSERT_LOCKED(sc);
+	if (sc->sc_offchan)
+		return;		/* will be restarted on the home channel */
+
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_TX, tag);
 	while ((m = mbufq_dequeue(&sc->sc_snd)) != NULL) {
 		if (sc->qfullmsk != 0) {
 			mbufq_prepend(&sc->sc_snd, m);
@@ -294,6 +321,7 @@ rtwn_start(struct rtwn_softc *sc)
 			break;
 		}
 	}
+	RTWN_REGACCT_RESTORE(sc, tag);
 }
 
 int
@@ -344,3 +372,141 @@ end:
 
 	return (error);
 }
+
+/*
+ * Select A-MPDU parameters for the frame: the spacing is the larger of
+ * ours and the peer's one; the number of subframes is limited by
+ * the peer's maximal A-MPDU length, the BA window, the airtime at
+ * the current rate and the recent loss rate.
+ */
+void
+rtwn_tx_ampdu_setup(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    struct mbuf *m, uint8_t tid, uint8_t ridx, int *density, int *maxagg)
+{
+	struct ieee80211vap *vap = ni->ni_vap;
+	struct ieee80211_tx_ampdu *tap;
+	struct rtwn_node *un = RTWN_NODE(ni);
+	uint32_t airtime;
+	int len, n, per;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	*density = MAX(vap->iv_ampdu_density,
+	    (ni->ni_htparam & IEEE80211_HTCAP_MPDUDENSITY) >>
+	    IEEE80211_HTCAP_MPDUDENSITY_S);
+
+	/* Subframe length (with delimiter and padding). */
+	len = roundup2(m->m_pkthdr.len + IEEE80211_CRC_LEN + 4, 4);
+	n = ((1 << (13 + (ni->ni_htparam & IEEE80211_HTCAP_MAXRXAMPDU))) -
+	    1) / len;
+
+	if (tid < WME_NUM_TID) {
+		/* Older net80211 keeps Tx A-MPDU state per AC, not per TID. */
+		if (nitems(ni->ni_tx_ampdu) == WME_NUM_TID)
+			tap = &ni->ni_tx_ampdu[tid];
+		else
+			tap = &ni->ni_tx_ampdu[TID_TO_WME_AC(tid)];
+		if (tap->txa_wnd != 0)
+			n = MIN(n, tap->txa_wnd);
+	}
+
+	airtime = rtwn_stats_airtime(ridx, m->m_pkthdr.len);
+	if (airtime != 0)
+		n = MIN(n, RTWN_AMPDU_MAXTIME / airtime);
+
+	/* Shorter aggregates lose less on a bad link. */
+	per = un->stats.tx_per;
+	if (per > RTWN_STATS_PER_ONE / 2)
+		n /= 4;
+	else if (per > RTWN_STATS_PER_ONE / 4)
+		n /= 2;
+
+	n = MIN(MAX(n, 1), RTWN_AMPDU_MAXAGG);
+	*maxagg = n;
+
+	un->stats.ampdu_maxagg = n;
+	un->stats.ampdu_density = *density;
+	rtwn_stats_tx_ampdu(un, tid, m->m_pkthdr.len, n);
+}
+
+/*
+ * Decide whether a Tx report should be requested for the data frame.
+ * Under load only 1 out of un->rpt_ival frames is reported, so the
+ * number of reports stays around RTWN_TXRPT_PPS per second.
+ */
+int
+rtwn_tx_report_request(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    uint8_t ridx)
+{
+	struct rtwn_node *un = RTWN_NODE(ni);
+	int elapsed, probe;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	/* Reports for the shared MACID cannot be matched to a node. */
+	if (!RTWN_RATECTL_TXRPT(sc) || RTWN_NODE_SHARED(un))
+		return (0);
+
+	/* Re-evaluate the interval once per second. */
+	un->rpt_frames++;
+	elapsed = ticks - un->rpt_ticks;
+	if (elapsed >= hz || elapsed < 0) {
+		un->rpt_ival = un->rpt_frames * hz / MAX(elapsed, hz) /
+		    RTWN_TXRPT_PPS;
+		un->rpt_ival = MIN(MAX(un->rpt_ival, 1),
+		    MAX(sc->sc_txrpt_max, 1));
+		un->rpt_frames = 0;
+		un->rpt_ticks = ticks;
+	}
+
+	/* Probes must be reported. */
+	probe = (sc->sc_ratectl == RTWN_RATECTL_DRV && un->rc.probe);
+	if (!probe && ++un->rpt_skip < un->rpt_ival) {
+		sc->sc_txrpt_skipped++;
+		return (0);
+	}
+
+	if (sc->sc_ratectl == RTWN_RATECTL_DRV) {
+		/* Recorded by rtwn_rc_tx_submit() once the frame is queued. */
+		un->rc.pending = ridx;
+		un->rc.pending_w = probe ? 1 : MIN(un->rpt_ival, UINT8_MAX);
+	}
+	if (!probe)
+		un->rpt_skip = 0;
+	sc->sc_txrpt_requested++;
+
+	return (1);
+}
+
+/*
+ * Feed net80211 rate control with frames which were sent
+ * without a report; they are assumed to share the reported status.
+ */
+void
+rtwn_tx_report_update(struct rtwn_softc *sc, struct ieee80211_node *ni,
+    int ntries, int success)
+{
+#if __FreeBSD_version >= 1200012
+	struct ieee80211_ratectl_tx_stats txs;
+#endif
+	int nframes, nsuccess, nretries;
+
+	nframes = RTWN_NODE(ni)->rpt_ival - 1;
+	if (nframes <= 0)
+		return;
+
+	nsuccess = success ? nframes : 0;
+	nretries = ntries * nframes;
+#if __FreeBSD_version >= 1200012
+	txs.flags = IEEE80211_RATECTL_TX_STATS_NODE |
+		    IEEE80211_RATECTL_TX_STATS_RETRIES;
+	txs.ni = ni;
+	txs.nframes = nframes;
+	txs.nsuccess = nsuccess;
+	txs.nretries = nretries;
+	ieee80211_ratectl_tx_update(ni->ni_vap, &txs);
+#else
+	ieee80211_ratectl_tx_update(ni->ni_vap, ni, &nframes, &nsuccess,
+	    &nretries);
+#endif
+}
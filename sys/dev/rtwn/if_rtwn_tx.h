@@ -19,6 +19,9 @@
 #ifndef IF_RTWN_TX_H
 #define IF_RTWN_TX_H
 
+#define RTWN_AMPDU_MAXAGG	0x1f	/* Tx descriptor limit */
+#define RTWN_AMPDU_MAXTIME	4000	/* usec */
+
 void	rtwn_drain_mbufq(struct rtwn_softc *);
 #ifdef IEEE80211_SUPPORT_SUPERG
 void	rtwn_ff_flush_all(struct rtwn_softc *, union sec_param *);
@@ -27,5 +30,11 @@ int	rtwn_transmit(struct ieee80211com *, struct mbuf *);
 void	rtwn_start(struct rtwn_softc *);
 int	rtwn_raw_xmit(struct ieee80211_node *, struct mbuf *,
 	    const struct ieee80211_bpf_params *);
+void	rtwn_tx_ampdu_setup(struct rtwn_softc *, struct ieee80211_node *,
+	    struct mbuf *, uint8_t, uint8_t, int *, int *);
+int	rtwn_tx_report_request(struct rtwn_softc *, struct ieee80211_node *,
+	    uint8_t);
+void	rtwn_tx_report_update(struct rtwn_softc *, struct ieee80211_node *,
+	    int, int);
 
 #endif	/* IF_RTWN_TX_H */
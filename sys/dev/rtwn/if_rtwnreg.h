@@ -40,7 +40,11 @@ struct rtwn_tx_desc_common {
 #define RTWN_TXDW1_CIPHER_SM4	2
 #define RTWN_TXDW1_CIPHER_AES	3
 
-	uint32_t	reserved[5];
+	uint32_t	txdw2;
+/* Tx report request (CCX_RPT / SPE_RPT) */
+#define RTWN_TXDW2_RPT		0x00080000
+
+	uint32_t	reserved[4];
 
 	union txdw7_shared {
 		uint16_t	usb_checksum;
@@ -30,11 +30,13 @@
 
 #define RTWN_BCN_MAX_SIZE	512
 #define RTWN_CAM_ENTRY_LIMIT	64
+#define RTWN_CAM_ENTRY_WORDS	8
 
 #define RTWN_MACID_BC		1	/* Broadcast. */
 #define RTWN_MACID_UNDEFINED	0x7fff
 #define RTWN_MACID_VALID 	0x8000
 #define RTWN_MACID_LIMIT	128
+#define RTWN_MACID_GRACE	(hz / 2)	/* before MACID reuse */
 
 #define RTWN_TX_TIMEOUT		5000	/* ms */
 #define RTWN_MAX_EPOUT		4
@@ -93,13 +95,156 @@ struct rtwn_cmdq {
 };
 #define RTWN_CMDQ_SIZE		16
 
+/*
+ * Host to firmware (H2C) command, ready to be written into a mailbox.
+ */
+struct rtwn_h2c {
+	uint32_t		box;
+	uint32_t		ext;
+	uint16_t		ext_reg;	/* extension register for box 0 */
+	uint8_t			ext_len;	/* 0, 2 or 4 */
+	uint8_t			id;
+	int			key;		/* merge key (usually MACID) */
+#define RTWN_H2C_NOMERGE	-1
+	sbintime_t		queued;
+};
+#define RTWN_H2C_QSIZE		16
+#define RTWN_H2C_NID		128
+
+struct rtwn_h2c_stat {
+	uint32_t		sent;
+	uint32_t		merged;
+	uint32_t		lat_max;	/* usec */
+	uint64_t		lat_sum;	/* usec */
+};
+
+#define RTWN_STATS_NRATES	28	/* RTWN_RIDX_COUNT */
+
+/*
+ * Register access accounting; accesses are attributed to the
+ * subsystem which is active in the current thread.
+ * NB: a per-softc tag is not enough: USB register accesses may
+ * drop RTWN_LOCK(), so several subsystems can be in progress.
+ */
+enum {
+	RTWN_REGACCT_NONE = -1,	/* no tag in this thread */
+	RTWN_REGACCT_OTHER,
+	RTWN_REGACCT_INIT,
+	RTWN_REGACCT_CHAN,
+	RTWN_REGACCT_CALIB,
+	RTWN_REGACCT_CAM,
+	RTWN_REGACCT_BEACON,
+	RTWN_REGACCT_RX,
+	RTWN_REGACCT_TX,
+	RTWN_REGACCT_FW,
+	RTWN_REGACCT_MAX
+};
+
+/* Power save levels (see if_rtwn_ps.c). */
+enum {
+	RTWN_PS_AWAKE,
+	RTWN_PS_LPS,
+	RTWN_PS_DEEP,
+	RTWN_PS_MAX
+};
+
+struct rtwn_regacct_owner {
+	struct thread		*td;
+	int			tag;
+};
+#define RTWN_REGACCT_OWNERS	4
+
+struct rtwn_regacct {
+	uint64_t		reads;
+	uint64_t		writes;
+	uint64_t		bytes;
+	uint64_t		retries;
+	uint64_t		usec;		/* bus time */
+};
+
+/*
+ * Per-node link statistics.
+ * NB: Rx / Tx counters are updated under RTWN_LOCK(), Tx status
+ * counters - under RTWN_NT_LOCK().
+ */
+struct rtwn_node_stats {
+	uint64_t		rx_packets;
+	uint64_t		rx_bytes;
+	uint64_t		rx_airtime;	/* usec, estimated */
+	uint64_t		tx_packets;
+	uint64_t		tx_bytes;
+	uint64_t		tx_airtime;	/* usec, estimated */
+	uint64_t		tx_reports;
+	uint64_t		tx_retries;
+	uint64_t		tx_failed;
+	int			rssi_ema;	/* dBm * 16 */
+	int			tx_per;		/* EMA, RTWN_STATS_PER_ONE */
+	uint32_t		rx_rate[RTWN_STATS_NRATES];
+
+	/* A-MPDU (aggregate boundaries are estimated). */
+	uint64_t		ampdu_mpdus;
+	uint64_t		ampdu_bytes;
+	uint64_t		ampdu_count;
+	int			ampdu_open;	/* subframes in current one */
+	int			ampdu_tid;
+	int			ampdu_maxagg;	/* last selected values */
+	int			ampdu_density;
+};
+#define RTWN_STATS_PER_ONE	1024
+
+/*
+ * Driver rate control state (RTWN_RATECTL_DRV); protected by RTWN_LOCK().
+ */
+struct rtwn_rc_stat {
+	uint32_t		attempts;	/* current interval */
+	uint32_t		success;
+	uint16_t		prob;		/* EWMA, RTWN_RC_PROB_ONE == 1 */
+	uint16_t		valid;
+	uint32_t		tp;		/* expected throughput, kbps */
+};
+
+#define RTWN_RC_FIFO		16
+
+struct rtwn_rc_node {
+	uint32_t		rates;		/* ridx mask; 0 - not set yet */
+	uint8_t			cur;		/* max throughput rate */
+	uint8_t			sample;		/* sampling cursor */
+	uint8_t			nframes;	/* frames since last sample */
+	uint8_t			probe;		/* Tx report is required */
+	uint8_t			pending;	/* reported rate, not queued */
+	uint8_t			pending_w;	/* 0 - nothing pending */
+	uint8_t			probe_ridx;	/* queued probe rate */
+	uint8_t			final_rate;	/* reports have final rate */
+	uint8_t			fifo_head;
+	uint8_t			fifo_len;
+	uint8_t			fifo[RTWN_RC_FIFO];	/* in-flight rates */
+	uint8_t			fifo_w[RTWN_RC_FIFO];	/* frames / report */
+	int			last_update;	/* ticks */
+	u_int			reset;		/* (re)association */
+	struct rtwn_rc_stat	st[RTWN_STATS_NRATES];
+};
+
 struct rtwn_node {
 	struct ieee80211_node	ni;	/* must be the first */
 	int			id;
 	int8_t			last_rssi;
 	int			avg_pwdb;
+	int			rpt_pwdb;	/* last value sent to f/w */
+	int			rpt_ival;	/* 1 Tx report per N frames */
+	int			rpt_skip;	/* frames since last report */
+	int			rpt_frames;	/* frames since rpt_ticks */
+	int			rpt_ticks;
+	struct rtwn_node_stats	stats;
+	struct rtwn_rc_node	rc;
 };
 #define RTWN_NODE(ni)		((struct rtwn_node *)(ni))
+/*
+ * Nodes which did not get their own MACID share the broadcast one.
+ * Neither firmware rate adaptation nor Tx reports (which carry only
+ * the MACID) are available for them, so they are sent at the rate
+ * initially chosen by rate control and never adapt.
+ */
+#define RTWN_NODE_SHARED(un)	((un)->id == RTWN_MACID_UNDEFINED)
 
 struct rtwn_vap {
 	struct ieee80211vap	vap;
@@ -110,6 +255,12 @@ struct rtwn_vap {
 	struct rtwn_tx_buf	bcn_desc;
 	struct mbuf		*bcn_mbuf;
 	struct timeout_task	tx_beacon_csa;
+	struct timeout_task	bcn_upd_task;
+	uint32_t		bcn_upd_items;	/* pending updates */
+	uint8_t			*bcn_last;	/* last pushed frame */
+	int			bcn_last_len;	/* 0 - unknown */
+	int			bcn_last_size;
+	int			bcn_upd_last;	/* ticks */
 
 	struct callout		tsf_sync_adhoc;
 	struct task		tsf_sync_adhoc_task;
@@ -150,8 +301,13 @@ enum {
 	RTWN_RATECTL_NONE,
 	RTWN_RATECTL_NET80211,
 	RTWN_RATECTL_FW,
+	RTWN_RATECTL_DRV,
 	RTWN_RATECTL_MAX
 };
+/* Modes which rely on per-frame Tx reports. */
+#define RTWN_RATECTL_TXRPT(_sc)				\
+	((_sc)->sc_ratectl == RTWN_RATECTL_NET80211 ||	\
+	 (_sc)->sc_ratectl == RTWN_RATECTL_DRV)
 
 /*
  * Control h/w crypto usage.
@@ -163,6 +319,15 @@ enum {
 	RTWN_CRYPTO_MAX,
 };
 
+/*
+ * TSF value sampled at some point of (local) uptime.
+ */
+struct rtwn_tsf_est {
+	uint64_t		tsf;
+	sbintime_t		sbt;
+	int			valid;
+};
+
 struct rtwn_softc {
 	struct ieee80211com	sc_ic;
 	struct mbufq		sc_snd;
@@ -176,6 +341,59 @@ struct rtwn_softc {
 	int			sc_ratectl_sysctl;
 	int			sc_ratectl;
 
+	/* Firmware RSSI reporting - under RTWN_NT_LOCK(). */
+	int			sc_rssi_delta;
+#define RTWN_RSSI_DELTA_DEF	3
+	int			sc_rssi_batch;
+#define RTWN_RSSI_BATCH_DEF	8
+	int			sc_rssi_next;
+	uint32_t		sc_rssi_sent;
+	uint32_t		sc_rssi_skipped;
+
+	/* Tx report sampling - under RTWN_LOCK(). */
+	int			sc_txrpt_max;
+#define RTWN_TXRPT_MAX_DEF	16
+#define RTWN_TXRPT_PPS		50	/* target reports / sec per node */
+	uint32_t		sc_txrpt_requested;
+	uint32_t		sc_txrpt_skipped;
+
+	/* Power save policy - under RTWN_LOCK(). */
+	struct callout		sc_ps_to;
+	int			sc_ps_level;
+	int			sc_ps_thresh;	/* frames / sec */
+	int			sc_ps_idle;	/* msec */
+	int			sc_ps_frames;
+	int			sc_ps_busy;	/* ticks */
+	int			sc_ps_since;	/* ticks */
+	uint64_t		sc_ps_time[RTWN_PS_MAX];	/* ticks */
+	uint32_t		sc_ps_transitions;
+
+	/* Beacon update statistics - under RTWN_LOCK(). */
+	uint32_t		sc_bcn_upd_requested;
+	uint32_t		sc_bcn_upd_merged;
+	uint32_t		sc_bcn_upd_pushed;
+	uint32_t		sc_bcn_upd_unchanged;
+
+	/* Background scan - under RTWN_LOCK(). */
+	int			sc_offchan;	/* AC queues are paused */
+	sbintime_t		sc_offchan_start;
+	int			sc_bgscan_idle;	/* msec */
+#define RTWN_BGSCAN_IDLE_DEF	0
+	uint32_t		sc_offchan_count;
+	uint64_t		sc_offchan_us;
+	uint32_t		sc_offchan_max_us;
+
+	/* Register access accounting - under RTWN_LOCK(). */
+	int			sc_regacct_enable;
+	struct rtwn_regacct_owner sc_regacct_owner[RTWN_REGACCT_OWNERS];
+	struct rtwn_regacct	sc_regacct[RTWN_REGACCT_MAX];
+
+	/* Event trace (see if_rtwn_trace.h). */
+	struct rtwn_trace_rec	*sc_trace;
+	u_int			sc_trace_head;
+	uint32_t		sc_trace_mask;
+	struct sysctl_oid	*sc_trace_oid;
+
 	uint8_t			sc_detached;
 	uint8_t			sc_flags;
 /* Device flags */
@@ -192,6 +410,10 @@ struct rtwn_softc {
 #define RTWN_CHIP_HAS_BCNQ1(_sc)	\
 	((_sc)->bcn_status_reg[0] != (_sc)->bcn_status_reg[1])
 
+/* Only monitor mode vaps are running (no node table lookups needed). */
+#define RTWN_MONITOR_ONLY(_sc)		\
+	((_sc)->nvaps == 0 && (_sc)->monvaps_running != 0)
+
 	void			*sc_priv;
 	const char		*name;
 	int			sc_ant;
@@ -210,16 +432,32 @@ struct rtwn_softc {
 
 	uint16_t		next_rom_addr;
 	uint8_t			keys_bmap[howmany(RTWN_CAM_ENTRY_LIMIT, NBBY)];
+	/* CAM manager - under RTWN_LOCK(). */
+	uint32_t		cam_shadow[RTWN_CAM_ENTRY_LIMIT]
+				    [RTWN_CAM_ENTRY_WORDS];
+	uint32_t		cam_allocs;
+	uint32_t		cam_swcrypt;
+	uint32_t		cam_writes;
+	uint32_t		cam_writes_skipped;
 
 	struct rtwn_vap		*vaps[RTWN_PORT_COUNT];
 	struct ieee80211_node	*node_list[RTWN_MACID_LIMIT];
 	struct mtx		nt_mtx;
+	/* MACID allocator - under RTWN_NT_LOCK(). */
+	uint32_t		macid_free[howmany(RTWN_MACID_LIMIT, 32)];
+	uint32_t		macid_grace[howmany(RTWN_MACID_LIMIT, 32)];
+	int			macid_freed_at[RTWN_MACID_LIMIT];
+	uint32_t		macid_exhausted;
 
 	struct callout		sc_calib_to;
 	struct callout		sc_pwrmode_init;
 #ifndef D4054
 	struct callout		sc_watchdog_to;
 	int			sc_tx_timer;
+	int			sc_tx_stall_ms;
+#define RTWN_TX_STALL_MS_DEF	1000
+	uint32_t		sc_tx_queue_resets;
+	uint32_t		sc_tx_restarts;
 #endif
 
 	struct mtx		sc_mtx;
@@ -235,6 +473,9 @@ struct rtwn_softc {
 	struct rtwn_rx_radiotap_header	sc_rxtap;
 	struct rtwn_tx_radiotap_header	sc_txtap;
 
+	struct rtwn_tsf_est	sc_tsf_est[RTWN_PORT_COUNT];
+	int			sc_tsf_pending;
+
 	int			ntxchains;
 	int			nrxchains;
 
@@ -249,6 +490,14 @@ struct rtwn_softc {
 	uint16_t		fwver;
 	uint16_t		fwsig;
 	int			fwcur;
+	struct rtwn_h2c		h2c_ring[RTWN_H2C_QSIZE];
+	int			h2c_first;
+	int			h2c_count;
+	sbintime_t		h2c_stall;
+	struct timeout_task	h2c_task;
+	struct rtwn_h2c_stat	h2c_stats[RTWN_H2C_NID];
+	uint32_t		h2c_dropped;
+	uint32_t		h2c_timeouts;
 
 	void		(*sc_node_free)(struct ieee80211_node *);
 	void		(*sc_scan_curchan)(struct ieee80211_scan_state *,
@@ -264,6 +513,10 @@ struct rtwn_softc {
 	uint8_t		(*sc_read_1)(struct rtwn_softc *, uint16_t);
 	uint16_t	(*sc_read_2)(struct rtwn_softc *, uint16_t);
 	uint32_t	(*sc_read_4)(struct rtwn_softc *, uint16_t);
+	int		(*sc_read_region)(struct rtwn_softc *, uint16_t,
+			    uint8_t *, int);
+	int		(*sc_write_region)(struct rtwn_softc *, uint16_t,
+			    const uint8_t *, int);
 	/* XXX eliminate */
 	void		(*sc_delay)(struct rtwn_softc *, int);
 	int		(*sc_tx_start)(struct rtwn_softc *,
@@ -272,7 +525,9 @@ struct rtwn_softc {
 	void		(*sc_start_xfers)(struct rtwn_softc *);
 	void		(*sc_reset_lists)(struct rtwn_softc *,
 			    struct ieee80211vap *);
+	void		(*sc_resize_lists)(struct rtwn_softc *);
 	void		(*sc_abort_xfers)(struct rtwn_softc *);
+	int		(*sc_tx_recover)(struct rtwn_softc *, int);
 	int		(*sc_fw_write_block)(struct rtwn_softc *,
 			    const uint8_t *, uint16_t, int);
 	uint16_t	(*sc_get_qmap)(struct rtwn_softc *);
@@ -344,7 +599,8 @@ struct rtwn_softc {
 			    int);
 	void		(*sc_handle_c2h_report)(struct rtwn_softc *,
 			    uint8_t *, int);
-	int		(*sc_check_frame)(struct rtwn_softc *, struct mbuf *);
+	int		(*sc_check_frame)(struct rtwn_softc *, struct mbuf *,
+			    const void *);
 	void		(*sc_temp_measure)(struct rtwn_softc *);
 	uint8_t		(*sc_temp_read)(struct rtwn_softc *);
 	void		(*sc_init_tx_agg)(struct rtwn_softc *);
@@ -411,12 +667,21 @@ MALLOC_DECLARE(M_RTWN_PRIV);
 	mtx_init(&(sc)->nt_mtx, "node table lock", NULL, MTX_DEF)
 #define RTWN_NT_LOCK(sc)		mtx_lock(&(sc)->nt_mtx)
 #define RTWN_NT_UNLOCK(sc)		mtx_unlock(&(sc)->nt_mtx)
+#define RTWN_NT_LOCK_ASSERT(sc)		mtx_assert(&(sc)->nt_mtx, MA_OWNED)
 #define RTWN_NT_LOCK_INITIALIZED(sc)	mtx_initialized(&(sc)->nt_mtx)
 #define RTWN_NT_LOCK_DESTROY(sc)	mtx_destroy(&(sc)->nt_mtx)
 
+#define RTWN_REGACCT_SET(_sc, _tag, _prev) \
+	((_prev) = rtwn_regacct_set((_sc), (_tag)))
+#define RTWN_REGACCT_RESTORE(_sc, _prev) \
+	rtwn_regacct_restore((_sc), (_prev))
+
 
 void	rtwn_sysctlattach(struct rtwn_softc *);
 
+int	rtwn_regacct_set(struct rtwn_softc *, int);
+void	rtwn_regacct_restore(struct rtwn_softc *, int);
+
 int	rtwn_attach(struct rtwn_softc *);
 void	rtwn_detach(struct rtwn_softc *);
 void	rtwn_resume(struct rtwn_softc *);
@@ -436,6 +701,10 @@ void	rtwn_suspend(struct rtwn_softc *);
 	(((_sc)->sc_read_2)((_sc), (_addr)))
 #define rtwn_read_4(_sc, _addr) \
 	(((_sc)->sc_read_4)((_sc), (_addr)))
+#define rtwn_read_region(_sc, _addr, _buf, _len) \
+	(((_sc)->sc_read_region)((_sc), (_addr), (_buf), (_len)))
+#define rtwn_write_region(_sc, _addr, _buf, _len) \
+	(((_sc)->sc_write_region)((_sc), (_addr), (_buf), (_len)))
 #define rtwn_delay(_sc, _usec) \
 	(((_sc)->sc_delay)((_sc), (_usec)))
 #define rtwn_tx_start(_sc, _ni, _m, _desc, _type, _id) \
@@ -444,8 +713,12 @@ void	rtwn_suspend(struct rtwn_softc *);
 	(((_sc)->sc_start_xfers)((_sc)))
 #define rtwn_reset_lists(_sc, _vap) \
 	(((_sc)->sc_reset_lists)((_sc), (_vap)))
+#define rtwn_resize_lists(_sc) \
+	(((_sc)->sc_resize_lists)((_sc)))
 #define rtwn_abort_xfers(_sc) \
 	(((_sc)->sc_abort_xfers)((_sc)))
+#define rtwn_tx_recover(_sc, _timo) \
+	(((_sc)->sc_tx_recover)((_sc), (_timo)))
 #define rtwn_fw_write_block(_sc, _buf, _reg, _len) \
 	(((_sc)->sc_fw_write_block)((_sc), (_buf), (_reg), (_len)))
 #define rtwn_get_qmap(_sc) \
@@ -543,8 +816,8 @@ void	rtwn_suspend(struct rtwn_softc *);
 	(((_sc)->sc_handle_tx_report)((_sc), (_buf), (_len)))
 #define rtwn_handle_c2h_report(_sc, _buf, _len) \
 	(((_sc)->sc_handle_c2h_report)((_sc), (_buf), (_len)))
-#define rtwn_check_frame(_sc, _m) \
-	(((_sc)->sc_check_frame)((_sc), (_m)))
+#define rtwn_check_frame(_sc, _m, _desc) \
+	(((_sc)->sc_check_frame)((_sc), (_m), (_desc)))
 #define rtwn_beacon_init(_sc, _buf, _id) \
 	(((_sc)->sc_beacon_init)((_sc), (_buf), (_id)))
 #define rtwn_beacon_enable(_sc, _id, _enable) \
@@ -35,6 +35,8 @@ __FBSDID("$FreeBSD$");
 #include <sys/endian.h>
 #include <sys/linker.h>
 #include <sys/kdb.h>
+#include <sys/sdt.h>
+#include <sys/taskqueue.h>
 
 #include <machine/bus.h>
 #include <machine/resource.h>
@@ -53,6 +55,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 #include <dev/rtwn/if_rtwn_nop.h>
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 
 #include <dev/rtwn/pci/rtwn_pci_var.h>
 
@@ -61,6 +64,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/pci/rtwn_pci_rx.h>
 #include <dev/rtwn/pci/rtwn_pci_tx.h>
 
+#include <dev/rtwn/rtl8192c/r92c_reg.h>
 #include <dev/rtwn/rtl8192c/pci/r92ce_reg.h>
 #include <dev/rtwn/rtl8192c/pci/r92ce_rx_desc.h>
 
@@ -72,17 +76,22 @@ static device_shutdown_t rtwn_pci_shutdown;
 static device_suspend_t	rtwn_pci_suspend;
 static device_resume_t	rtwn_pci_resume;
 
-static int	rtwn_pci_alloc_rx_list(struct rtwn_softc *);
+static int	rtwn_pci_alloc_rx_list(struct rtwn_softc *,
+		    struct rtwn_rx_ring *, int);
 static void	rtwn_pci_reset_rx_list(struct rtwn_softc *);
-static void	rtwn_pci_free_rx_list(struct rtwn_softc *);
+static void	rtwn_pci_resize_rx_list(struct rtwn_softc *);
+static void	rtwn_pci_free_rx_list(struct rtwn_softc *,
+		    struct rtwn_rx_ring *);
 static int	rtwn_pci_alloc_tx_list(struct rtwn_softc *, int);
 static void	rtwn_pci_reset_tx_ring_stopped(struct rtwn_softc *, int);
+static void	rtwn_pci_drain_tx_ring(struct rtwn_softc *, int);
 static void	rtwn_pci_reset_beacon_ring(struct rtwn_softc *, int);
 static void	rtwn_pci_reset_tx_list(struct rtwn_softc *,
 		    struct ieee80211vap *, int);
 static void	rtwn_pci_free_tx_list(struct rtwn_softc *, int);
 static void	rtwn_pci_reset_lists(struct rtwn_softc *,
 		    struct ieee80211vap *);
+static int	rtwn_pci_tx_recover(struct rtwn_softc *, int);
 static int	rtwn_pci_fw_write_block(struct rtwn_softc *,
 		    const uint8_t *, uint16_t, int);
 static uint16_t	rtwn_pci_get_qmap(struct rtwn_softc *);
@@ -92,10 +101,24 @@ static void	rtwn_pci_beacon_update_begin(struct rtwn_softc *,
 static void	rtwn_pci_beacon_update_end(struct rtwn_softc *,
 		    struct ieee80211vap *);
 static void	rtwn_pci_attach_methods(struct rtwn_softc *);
+static void	rtwn_pci_sysctlattach(struct rtwn_pci_softc *);
 
 
 static int matched_chip = RTWN_CHIP_MAX_PCI;
 
+/* Descriptor address / TXPAUSE bit for the rings which can be reset. */
+static const struct {
+	uint16_t	desa;
+	uint8_t		pause;
+} rtwn_pci_txq[RTWN_PCI_NTXQUEUES] = {
+	[RTWN_PCI_BK_QUEUE] =	{ R92C_BKQ_DESA, R92C_TX_QUEUE_BK },
+	[RTWN_PCI_BE_QUEUE] =	{ R92C_BEQ_DESA, R92C_TX_QUEUE_BE },
+	[RTWN_PCI_VI_QUEUE] =	{ R92C_VIQ_DESA, R92C_TX_QUEUE_VI },
+	[RTWN_PCI_VO_QUEUE] =	{ R92C_VOQ_DESA, R92C_TX_QUEUE_VO },
+	[RTWN_PCI_MGNT_QUEUE] =	{ R92C_MGQ_DESA, R92C_TX_QUEUE_MGT },
+	[RTWN_PCI_HIGH_QUEUE] =	{ R92C_HQ_DESA, R92C_TX_QUEUE_HIGH },
+};
+
 static int
 rtwn_pci_probe(device_t dev)
 {
@@ -112,17 +135,30 @@ rtwn_pci_probe(device_t dev)
 	return (ENXIO);
 }
 
+/*
+ * NB: descriptors are set up by rtwn_pci_reset_rx_list().
+ * Called from attach / rtwn_init() without sc_mtx, so allocations
+ * may sleep; DMA map loads must not be deferred (EINPROGRESS is
+ * treated as an error).
+ */
 static int
-rtwn_pci_alloc_rx_list(struct rtwn_softc *sc)
+rtwn_pci_alloc_rx_list(struct rtwn_softc *sc, struct rtwn_rx_ring *rx_ring,
+    int count)
 {
-	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
-	struct rtwn_rx_ring *rx_ring = &pc->rx_ring;
 	struct rtwn_rx_data *rx_data;
 	bus_size_t size;
 	int i, error;
 
+	rx_ring->rx_data = malloc(sizeof(*rx_ring->rx_data) * count,
+	    M_DEVBUF, M_WAITOK | M_ZERO);
+	if (rx_ring->rx_data == NULL) {
+		device_printf(sc->sc_dev, "could not allocate rx data\n");
+		return (ENOMEM);
+	}
+	rx_ring->count = count;
+
 	/* Allocate Rx descriptors. */
-	size = sizeof(struct r92ce_rx_stat) * RTWN_PCI_RX_LIST_COUNT;
+	size = sizeof(struct r92ce_rx_stat) * count;
 	error = bus_dma_tag_create(bus_get_dma_tag(sc->sc_dev), 1, 0,
 	    BUS_SPACE_MAXADDR_32BIT, BUS_SPACE_MAXADDR, NULL, NULL,
 	    size, 1, size, 0, NULL, NULL, &rx_ring->desc_dmat);
@@ -132,14 +168,15 @@ rtwn_pci_alloc_rx_list(struct rtwn_softc *sc)
 	}
 
 	error = bus_dmamem_alloc(rx_ring->desc_dmat, (void **)&rx_ring->desc,
-	    BUS_DMA_NOWAIT | BUS_DMA_ZERO | BUS_DMA_COHERENT,
+	    BUS_DMA_WAITOK | BUS_DMA_ZERO | BUS_DMA_COHERENT,
 	    &rx_ring->desc_map);
 	if (error != 0) {
 		device_printf(sc->sc_dev, "could not allocate rx desc\n");
 		goto fail;
 	}
 	error = bus_dmamap_load(rx_ring->desc_dmat, rx_ring->desc_map,
-	    rx_ring->desc, size, rtwn_pci_dma_map_addr, &rx_ring->paddr, 0);
+	    rx_ring->desc, size, rtwn_pci_dma_map_addr, &rx_ring->paddr,
+	    BUS_DMA_NOWAIT);
 	if (error != 0) {
 		device_printf(sc->sc_dev, "could not load rx desc DMA map\n");
 		goto fail;
@@ -157,7 +194,7 @@ rtwn_pci_alloc_rx_list(struct rtwn_softc *sc)
 	}
 
 	/* Allocate Rx buffers. */
-	for (i = 0; i < RTWN_PCI_RX_LIST_COUNT; i++) {
+	for (i = 0; i < count; i++) {
 		rx_data = &rx_ring->rx_data[i];
 		error = bus_dmamap_create(rx_ring->data_dmat, 0, &rx_data->map);
 		if (error != 0) {
@@ -166,7 +203,7 @@ rtwn_pci_alloc_rx_list(struct rtwn_softc *sc)
 			goto fail;
 		}
 
-		rx_data->m = m_getjcl(M_NOWAIT, MT_DATA, M_PKTHDR,
+		rx_data->m = m_getjcl(M_WAITOK, MT_DATA, M_PKTHDR,
 		    MJUMPAGESIZE);
 		if (rx_data->m == NULL) {
 			device_printf(sc->sc_dev,
@@ -183,16 +220,13 @@ rtwn_pci_alloc_rx_list(struct rtwn_softc *sc)
 			    "could not load rx buf DMA map");
 			goto fail;
 		}
-
-		rtwn_pci_setup_rx_desc(pc, &rx_ring->desc[i], rx_data->paddr,
-		    MJUMPAGESIZE, i);
 	}
 	rx_ring->cur = 0;
 
 	return (0);
 
 fail:
-	rtwn_pci_free_rx_list(sc);
+	rtwn_pci_free_rx_list(sc, rx_ring);
 	return (error);
 }
 
@@ -204,19 +238,66 @@ rtwn_pci_reset_rx_list(struct rtwn_softc *sc)
 	struct rtwn_rx_data *rx_data;
 	int i;
 
-	for (i = 0; i < RTWN_PCI_RX_LIST_COUNT; i++) {
+	for (i = 0; i < rx_ring->count; i++) {
 		rx_data = &rx_ring->rx_data[i];
 		rtwn_pci_setup_rx_desc(pc, &rx_ring->desc[i],
 		    rx_data->paddr, MJUMPAGESIZE, i);
 	}
+	bus_dmamap_sync(rx_ring->desc_dmat, rx_ring->desc_map,
+	    BUS_DMASYNC_PREWRITE);
 	rx_ring->cur = 0;
 }
 
+/*
+ * Apply new Rx ring size (if any); called by rtwn_init() without
+ * sc_mtx, before Rx DMA is set up.  The old ring is kept when a new
+ * one cannot be allocated or the device was started meanwhile.
+ */
 static void
-rtwn_pci_free_rx_list(struct rtwn_softc *sc)
+rtwn_pci_resize_rx_list(struct rtwn_softc *sc)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
-	struct rtwn_rx_ring *rx_ring = &pc->rx_ring;
+	struct rtwn_rx_ring rx_ring, old_ring;
+	int count, error, old;
+
+	count = MIN(MAX(pc->pc_rx_ring_size, RTWN_PCI_RX_LIST_MIN),
+	    RTWN_PCI_RX_LIST_MAX);
+	RTWN_LOCK(sc);
+	old = (sc->sc_flags & RTWN_RUNNING) ? count : pc->rx_ring.count;
+	RTWN_UNLOCK(sc);
+	if (count == old)
+		return;
+
+	memset(&rx_ring, 0, sizeof(rx_ring));
+	error = rtwn_pci_alloc_rx_list(sc, &rx_ring, count);
+	if (error != 0) {
+		device_printf(sc->sc_dev,
+		    "could not resize Rx ring (%d -> %d), error %d\n",
+		    old, count, error);
+		return;
+	}
+
+	RTWN_LOCK(sc);
+	if (sc->sc_flags & RTWN_RUNNING) {
+		RTWN_UNLOCK(sc);
+		rtwn_pci_free_rx_list(sc, &rx_ring);
+		return;
+	}
+	RTWN_DPRINTF(sc, RTWN_DEBUG_RESET, "%s: Rx ring: %d -> %d\n",
+	    __func__, pc->rx_ring.count, count);
+
+	/* Swap the rings; the old one is freed without the lock. */
+	old_ring = pc->rx_ring;
+	pc->rx_ring = rx_ring;
+	rtwn_pci_reset_rx_list(sc);
+	RTWN_UNLOCK(sc);
+
+	rtwn_pci_free_rx_list(sc, &old_ring);
+}
+
+static void
+rtwn_pci_free_rx_list(struct rtwn_softc *sc, struct rtwn_rx_ring *rx_ring)
+{
 	struct rtwn_rx_data *rx_data;
 	int i;
 
@@ -235,7 +316,7 @@ rtwn_pci_free_rx_list(struct rtwn_softc *sc)
 		rx_ring->desc_dmat = NULL;
 	}
 
-	for (i = 0; i < RTWN_PCI_RX_LIST_COUNT; i++) {
+	for (i = 0; i < rx_ring->count && rx_ring->rx_data != NULL; i++) {
 		rx_data = &rx_ring->rx_data[i];
 
 		if (rx_data->m != NULL) {
@@ -252,6 +333,11 @@ rtwn_pci_free_rx_list(struct rtwn_softc *sc)
 		bus_dma_tag_destroy(rx_ring->data_dmat);
 		rx_ring->data_dmat = NULL;
 	}
+	if (rx_ring->rx_data != NULL) {
+		free(rx_ring->rx_data, M_DEVBUF);
+		rx_ring->rx_data = NULL;
+	}
+	rx_ring->count = 0;
 }
 
 static int
@@ -353,6 +439,58 @@ rtwn_pci_reset_tx_ring_stopped(struct rtwn_softc *sc, int qid)
 	ring->last = ring->cur = 0;
 }
 
+/*
+ * Complete all queued frames with an error status and rewind the ring;
+ * the caller must stop Tx DMA first.
+ */
+static void
+rtwn_pci_drain_tx_ring(struct rtwn_softc *sc, int qid)
+{
+	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+	struct rtwn_tx_ring *ring = &pc->tx_ring[qid];
+	struct rtwn_tx_desc_common *desc;
+	struct rtwn_tx_data *data;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	bus_dmamap_sync(ring->desc_dmat, ring->desc_map,
+	    BUS_DMASYNC_POSTREAD | BUS_DMASYNC_POSTWRITE);
+
+	while (ring->last != ring->cur) {
+		data = &ring->tx_data[ring->last];
+		desc = (struct rtwn_tx_desc_common *)
+		    ((uint8_t *)ring->desc + sc->txdesc_len * ring->last);
+
+		if (data->m != NULL) {
+			bus_dmamap_sync(ring->data_dmat, data->map,
+			    BUS_DMASYNC_POSTWRITE);
+			bus_dmamap_unload(ring->data_dmat, data->map);
+
+			if (data->ni != NULL) {
+				/* Tx report will not arrive for this frame. */
+				if ((desc->txdw2 & htole32(RTWN_TXDW2_RPT)) &&
+				    sc->sc_tx_n_active > 0)
+					sc->sc_tx_n_active--;
+
+				ieee80211_tx_complete(data->ni, data->m, 1);
+				data->ni = NULL;
+			} else
+				m_freem(data->m);
+			data->m = NULL;
+		}
+
+		rtwn_pci_copy_tx_desc(pc, desc, NULL);
+		ring->last = (ring->last + 1) % RTWN_PCI_TX_LIST_COUNT;
+	}
+
+	bus_dmamap_sync(ring->desc_dmat, ring->desc_map,
+	    BUS_DMASYNC_PREWRITE);
+
+	sc->qfullmsk &= ~(1 << qid);
+	ring->queued = 0;
+	ring->last = ring->cur = 0;
+}
+
 /*
  * Clear entry 0 (or 1) in the beacon queue (other are not used).
  */
@@ -475,11 +613,86 @@ rtwn_pci_reset_lists(struct rtwn_softc *sc, struct ieee80211vap *vap)
 		rtwn_pci_reset_tx_list(sc, vap, i);
 
 	if (vap == NULL) {
+		struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+
 		sc->qfullmsk = 0;
+		pc->pc_pend_status = pc->pc_pend_rings = 0;
+		pc->pc_rx_boost = 0;
+		callout_stop(&pc->pc_holdoff_to);
 		rtwn_pci_reset_rx_list(sc);
 	}
 }
 
+/*
+ * Reset Tx rings which did not complete anything during 'timo' ticks.
+ * Returns the number of stuck rings or -1 if the device should be
+ * restarted instead.
+ *
+ * Like rtwn_pci_stop() / rtwn_pci_set_desc_addr(), descriptor addresses
+ * are rewritten only when host Tx DMA is disabled; since the engine
+ * is shared, all data rings are drained and rewound together.
+ */
+static int
+rtwn_pci_tx_recover(struct rtwn_softc *sc, int timo)
+{
+	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+	struct rtwn_tx_ring *ring;
+	uint8_t pause;
+	int qid, nreset;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	nreset = 0;
+	for (qid = 0; qid < RTWN_PCI_NTXQUEUES; qid++) {
+		ring = &pc->tx_ring[qid];
+		if (qid == RTWN_PCI_BEACON_QUEUE || ring->queued == 0)
+			continue;
+		if (ticks - ring->last_done < timo)
+			continue;
+
+		/* Did not help last time (or cannot be reset at all). */
+		if (ring->resets >= RTWN_PCI_TX_RESET_MAX ||
+		    rtwn_pci_txq[qid].desa == 0)
+			return (-1);
+
+		RTWN_DPRINTF(sc, RTWN_DEBUG_RESET,
+		    "%s: qid %d: %d frames stuck, last %d, cur %d\n",
+		    __func__, qid, ring->queued, ring->last, ring->cur);
+
+		ring->resets++;
+		nreset++;
+	}
+
+	if (nreset == 0)
+		return (0);
+
+	/* Stop Tx DMA. */
+	pause = rtwn_pci_read_1(sc, R92C_TXPAUSE);
+	rtwn_pci_write_1(sc, R92C_TXPAUSE, pause | R92C_TX_QUEUE_AC |
+	    R92C_TX_QUEUE_MGT | R92C_TX_QUEUE_HIGH);
+	rtwn_setbits_2(sc, R92C_CR, R92C_CR_HCI_TXDMA_EN, 0);
+
+	/* Drop all queued frames and rewind DMA pointers. */
+	for (qid = 0; qid < RTWN_PCI_NTXQUEUES; qid++) {
+		if (rtwn_pci_txq[qid].desa == 0)
+			continue;
+
+		ring = &pc->tx_ring[qid];
+		rtwn_pci_drain_tx_ring(sc, qid);
+		rtwn_pci_write_4(sc, rtwn_pci_txq[qid].desa, ring->paddr);
+		ring->last_done = ticks;
+	}
+
+	rtwn_setbits_2(sc, R92C_CR, 0, R92C_CR_HCI_TXDMA_EN);
+	rtwn_pci_write_1(sc, R92C_TXPAUSE, pause);
+
+#ifndef D4054
+	sc->sc_tx_timer = 0;
+#endif
+
+	return (nreset);
+}
+
 static int
 rtwn_pci_fw_write_block(struct rtwn_softc *sc, const uint8_t *buf,
     uint16_t reg, int mlen)
@@ -573,10 +786,14 @@ rtwn_pci_attach_methods(struct rtwn_softc *sc)
 	sc->sc_read_1		= rtwn_pci_read_1;
 	sc->sc_read_2		= rtwn_pci_read_2;
 	sc->sc_read_4		= rtwn_pci_read_4;
+	sc->sc_read_region	= rtwn_pci_read_region_1;
+	sc->sc_write_region	= rtwn_pci_write_region_1;
 	sc->sc_delay		= rtwn_pci_delay;
 	sc->sc_tx_start		= rtwn_pci_tx_start;
 	sc->sc_reset_lists	= rtwn_pci_reset_lists;
+	sc->sc_resize_lists	= rtwn_pci_resize_rx_list;
 	sc->sc_abort_xfers	= rtwn_nop_softc;
+	sc->sc_tx_recover	= rtwn_pci_tx_recover;
 	sc->sc_fw_write_block	= rtwn_pci_fw_write_block;
 	sc->sc_get_qmap		= rtwn_pci_get_qmap;
 	sc->sc_set_desc_addr	= rtwn_pci_set_desc_addr;
@@ -588,6 +805,55 @@ rtwn_pci_attach_methods(struct rtwn_softc *sc)
 	sc->bcn_check_interval	= 25000;
 }
 
+static void
+rtwn_pci_sysctlattach(struct rtwn_pci_softc *pc)
+{
+	struct rtwn_softc *sc = &pc->pc_sc;
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	pc->pc_intr_poll = 0;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "intr_poll", CTLFLAG_RWTUN, &pc->pc_intr_poll,
+	    pc->pc_intr_poll, "Defer Rx/Tx processing to the taskqueue "
+	    "(0 - process in the interrupt handler, 1 - poll with budget)");
+
+	pc->pc_rx_budget = RTWN_PCI_RX_BUDGET;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_budget", CTLFLAG_RWTUN, &pc->pc_rx_budget,
+	    pc->pc_rx_budget, "Max number of Rx descriptors per poll pass");
+
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_overflow", CTLFLAG_RD, &pc->pc_rx_overflow, 0,
+	    "Number of Rx FIFO overflow interrupts");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_desc_unavail", CTLFLAG_RD, &pc->pc_rx_desc_unavail, 0,
+	    "Number of Rx descriptor unavailable interrupts");
+
+	pc->pc_rx_ring_size = RTWN_PCI_RX_LIST_COUNT;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_ring_size", CTLFLAG_RWTUN, &pc->pc_rx_ring_size,
+	    pc->pc_rx_ring_size, "Number of Rx descriptors ("
+	    __XSTRING(RTWN_PCI_RX_LIST_MIN) ".."
+	    __XSTRING(RTWN_PCI_RX_LIST_MAX) "; applied when the device "
+	    "is started)");
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_ring_count", CTLFLAG_RD, &pc->rx_ring.count, 0,
+	    "Number of Rx descriptors in use");
+
+	pc->pc_tx_budget = RTWN_PCI_TX_BUDGET;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "tx_budget", CTLFLAG_RWTUN, &pc->pc_tx_budget,
+	    pc->pc_tx_budget,
+	    "Max number of Tx completions per ring per poll pass");
+
+	pc->pc_intr_holdoff = 0;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "intr_holdoff", CTLFLAG_RWTUN, &pc->pc_intr_holdoff,
+	    pc->pc_intr_holdoff,
+	    "Delay (in usec) before interrupts are unmasked again");
+}
+
 static int
 rtwn_pci_attach(device_t dev)
 {
@@ -646,20 +912,32 @@ rtwn_pci_attach(device_t dev)
 
 	/* Need to be initialized early. */
 	rtwn_sysctlattach(sc);
+	rtwn_pci_sysctlattach(pc);
 	mtx_init(&sc->sc_mtx, ic->ic_name, MTX_NETWORK_LOCK, MTX_DEF);
 
+	/* Deferred interrupt processing. */
+	callout_init_mtx(&pc->pc_holdoff_to, &sc->sc_mtx, 0);
+	TASK_INIT(&pc->pc_intr_task, 0, rtwn_pci_intr_task, sc);
+	pc->pc_tq = taskqueue_create("rtwn_pci_taskq", M_WAITOK,
+	    taskqueue_thread_enqueue, &pc->pc_tq);
+	taskqueue_start_threads(&pc->pc_tq, 1, PI_NET, "%s taskq",
+	    device_get_nameunit(dev));
+
 	rtwn_pci_attach_methods(sc);
 	/* XXX something similar to USB_GET_DRIVER_INFO() */
 	rtwn_pci_attach_private(pc, matched_chip);
 
 	/* Allocate Tx/Rx buffers. */
-	error = rtwn_pci_alloc_rx_list(sc);
+	error = rtwn_pci_alloc_rx_list(sc, &pc->rx_ring,
+	    MIN(MAX(pc->pc_rx_ring_size, RTWN_PCI_RX_LIST_MIN),
+	    RTWN_PCI_RX_LIST_MAX));
 	if (error != 0) {
 		device_printf(dev,
 		    "could not allocate Rx buffers, error %d\n",
 		    error);
 		goto detach;
 	}
+	rtwn_pci_reset_rx_list(sc);
 	for (i = 0; i < RTWN_PCI_NTXQUEUES; i++) {
 		error = rtwn_pci_alloc_tx_list(sc, i);
 		if (error != 0) {
@@ -711,10 +989,18 @@ rtwn_pci_detach(device_t dev)
 		pci_release_msi(dev);
 	}
 
+	if (pc->pc_tq != NULL) {
+		callout_drain(&pc->pc_holdoff_to);
+		taskqueue_drain(pc->pc_tq, &pc->pc_intr_task);
+		taskqueue_free(pc->pc_tq);
+		pc->pc_tq = NULL;
+	}
+
 	/* Free Tx/Rx buffers. */
 	for (i = 0; i < RTWN_PCI_NTXQUEUES; i++)
 		rtwn_pci_free_tx_list(sc, i);
-	rtwn_pci_free_rx_list(sc);
+	rtwn_pci_free_rx_list(sc, &pc->rx_ring);
+	rtwn_trace_free(sc);
 
 	if (pc->mem != NULL)
 		bus_release_resource(dev, SYS_RES_MEMORY,
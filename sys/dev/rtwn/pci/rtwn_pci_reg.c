@@ -30,6 +30,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -46,6 +47,8 @@ __FBSDID("$FreeBSD$");
 #include <net80211/ieee80211_radiotap.h>
 
 #include <dev/rtwn/if_rtwnvar.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 
 #include <dev/rtwn/pci/rtwn_pci_var.h>
 #include <dev/rtwn/pci/rtwn_pci_reg.h>
@@ -56,6 +59,10 @@ rtwn_pci_write_1(struct rtwn_softc *sc, uint16_t addr, uint8_t val)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 
+	RTWN_TRACE(sc, REG_WRITE, reg__write, addr, val, 1, 0);
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 1, 1, 0, 0);
+
 	bus_space_write_1(pc->pc_st, pc->pc_sh, addr, val);
 
 	return (0);
@@ -66,6 +73,10 @@ rtwn_pci_write_2(struct rtwn_softc *sc, uint16_t addr, uint16_t val)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 
+	RTWN_TRACE(sc, REG_WRITE, reg__write, addr, val, 2, 0);
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 1, 2, 0, 0);
+
 	val = htole16(val);
 	bus_space_write_2(pc->pc_st, pc->pc_sh, addr, val);
 
@@ -77,17 +88,53 @@ rtwn_pci_write_4(struct rtwn_softc *sc, uint16_t addr, uint32_t val)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 
+	RTWN_TRACE(sc, REG_WRITE, reg__write, addr, val, 4, 0);
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 1, 4, 0, 0);
+
 	val = htole32(val);
 	bus_space_write_4(pc->pc_st, pc->pc_sh, addr, val);
 
 	return (0);
 }
 
+int
+rtwn_pci_write_region_1(struct rtwn_softc *sc, uint16_t addr,
+    const uint8_t *buf, int len)
+{
+	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+
+	RTWN_TRACE(sc, REG_WRITE, reg__write, addr,
+	    len >= 4 ? le32dec(buf) : buf[0], len, 0);
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 1, len, 0, 0);
+
+	/* In ascending order; use 32-bit accesses for aligned parts. */
+	while (len > 0) {
+		if ((addr & 3) == 0 && len >= 4) {
+			bus_space_write_4(pc->pc_st, pc->pc_sh, addr,
+			    htole32(le32dec(buf)));
+			addr += 4;
+			buf += 4;
+			len -= 4;
+		} else {
+			bus_space_write_1(pc->pc_st, pc->pc_sh, addr++,
+			    *buf++);
+			len--;
+		}
+	}
+
+	return (0);
+}
+
 uint8_t
 rtwn_pci_read_1(struct rtwn_softc *sc, uint16_t addr)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 0, 1, 0, 0);
+
 	return (bus_space_read_1(pc->pc_st, pc->pc_sh, addr));
 }
 
@@ -97,6 +144,9 @@ rtwn_pci_read_2(struct rtwn_softc *sc, uint16_t addr)
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 	uint16_t val;
 
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 0, 2, 0, 0);
+
 	val = bus_space_read_2(pc->pc_st, pc->pc_sh, addr);
 	return le16toh(val);
 }
@@ -107,10 +157,41 @@ rtwn_pci_read_4(struct rtwn_softc *sc, uint16_t addr)
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 	uint32_t val;
 
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 0, 4, 0, 0);
+
 	val = bus_space_read_4(pc->pc_st, pc->pc_sh, addr);
 	return le32toh(val);
 }
 
+int
+rtwn_pci_read_region_1(struct rtwn_softc *sc, uint16_t addr, uint8_t *buf,
+    int len)
+{
+	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+	uint32_t val;
+
+	if (sc->sc_regacct_enable)
+		rtwn_stats_reg(sc, 0, len, 0, 0);
+
+	/* Use 32-bit accesses for aligned parts. */
+	while (len > 0) {
+		if ((addr & 3) == 0 && len >= 4) {
+			val = bus_space_read_4(pc->pc_st, pc->pc_sh, addr);
+			le32enc(buf, le32toh(val));
+			addr += 4;
+			buf += 4;
+			len -= 4;
+		} else {
+			*buf++ = bus_space_read_1(pc->pc_st, pc->pc_sh,
+			    addr++);
+			len--;
+		}
+	}
+
+	return (0);
+}
+
 void
 rtwn_pci_delay(struct rtwn_softc *sc, int usec)
 {
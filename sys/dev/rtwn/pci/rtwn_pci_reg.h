@@ -22,9 +22,13 @@
 int		rtwn_pci_write_1(struct rtwn_softc *, uint16_t, uint8_t);
 int		rtwn_pci_write_2(struct rtwn_softc *, uint16_t, uint16_t);
 int		rtwn_pci_write_4(struct rtwn_softc *, uint16_t, uint32_t);
+int		rtwn_pci_write_region_1(struct rtwn_softc *, uint16_t,
+		    const uint8_t *, int);
 uint8_t		rtwn_pci_read_1(struct rtwn_softc *, uint16_t);
 uint16_t	rtwn_pci_read_2(struct rtwn_softc *, uint16_t);
 uint32_t	rtwn_pci_read_4(struct rtwn_softc *, uint16_t);
+int		rtwn_pci_read_region_1(struct rtwn_softc *, uint16_t,
+		    uint8_t *, int);
 void		rtwn_pci_delay(struct rtwn_softc *, int);
 
 #endif	/* RTWN_PCI_REG_H */
@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -51,6 +52,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwn_debug.h>
 #include <dev/rtwn/if_rtwn_rx.h>
 #include <dev/rtwn/if_rtwn_task.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 #include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/pci/rtwn_pci_var.h>
@@ -77,7 +79,7 @@ rtwn_pci_setup_rx_desc(struct rtwn_pci_softc *pc, struct r92ce_rx_stat *desc,
 
 	memset(desc, 0, sizeof(*desc));
 	desc->rxdw0 = htole32(SM(R92C_RXDW0_PKTLEN, len) |
-		((idx == RTWN_PCI_RX_LIST_COUNT - 1) ? R92C_RXDW0_EOR : 0));
+		((idx == pc->rx_ring.count - 1) ? R92C_RXDW0_EOR : 0));
 	desc->rxbufaddr = htole32(addr);
 	bus_space_barrier(pc->pc_st, pc->pc_sh, 0, pc->pc_mapsize,
 	    BUS_SPACE_BARRIER_WRITE);
@@ -159,6 +161,11 @@ rtwn_pci_rx_frame(struct rtwn_pci_softc *pc)
 	rx_data->m = m1;
 	m->m_pkthdr.len = m->m_len = pktlen + infosz + shift;
 
+	if (rtwn_check_frame(sc, m, rx_desc) != 0) {
+		m_freem(m);
+		goto fail;
+	}
+
 	nf = RTWN_NOISE_FLOOR;
 	ni = rtwn_rx_common(sc, m, rx_desc, &rssi);
 
@@ -222,7 +229,7 @@ rtwn_pci_tx_report(struct rtwn_pci_softc *pc, int len)
 {
 	struct rtwn_softc *sc = &pc->pc_sc;
 
-	if (sc->sc_ratectl != RTWN_RATECTL_NET80211) {
+	if (!RTWN_RATECTL_TXRPT(sc)) {
 		/* shouldn't happen */
 		device_printf(sc->sc_dev,
 		    "%s called while ratectl = %d!\n",
@@ -249,13 +256,14 @@ rtwn_pci_c2h_report(struct rtwn_pci_softc *pc, int len)
 	rtwn_handle_c2h_report(&pc->pc_sc, pc->pc_rx_buf, len);
 }
 
-static void
-rtwn_pci_tx_done(struct rtwn_softc *sc, int qid)
+static int
+rtwn_pci_tx_done(struct rtwn_softc *sc, int qid, int budget)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 	struct rtwn_tx_ring *ring = &pc->tx_ring[qid];
 	struct rtwn_tx_desc_common *desc;
 	struct rtwn_tx_data *data;
+	int more = 0;
 
 	RTWN_DPRINTF(sc, RTWN_DEBUG_INTR, "%s: qid %d, last %d, cur %d\n",
 	    __func__, qid, ring->last, ring->cur);
@@ -264,6 +272,11 @@ rtwn_pci_tx_done(struct rtwn_softc *sc, int qid)
 	    BUS_DMASYNC_POSTREAD | BUS_DMASYNC_POSTWRITE);
 
 	while(ring->last != ring->cur) {
+		if (budget-- == 0) {
+			more = 1;
+			break;
+		}
+
 		data = &ring->tx_data[ring->last];
 		desc = (struct rtwn_tx_desc_common *)
 		    ((uint8_t *)ring->desc + sc->txdesc_len * ring->last);
@@ -290,6 +303,8 @@ rtwn_pci_tx_done(struct rtwn_softc *sc, int qid)
 
 		data->m = NULL;
 		ring->last = (ring->last + 1) % RTWN_PCI_TX_LIST_COUNT;
+		ring->last_done = ticks;
+		ring->resets = 0;
 #ifndef D4054
 		if (ring->queued > 0)
 			sc->sc_tx_timer = 5;
@@ -310,7 +325,7 @@ rtwn_pci_tx_done(struct rtwn_softc *sc, int qid)
 	 * threshold, ensure we age fast-frames out so they're
 	 * transmitted.
 	 */
-	if (sc->sc_ratectl != RTWN_RATECTL_NET80211 && ring->queued <= 1) {
+	if (!RTWN_RATECTL_TXRPT(sc) && ring->queued <= 1) {
 		/*
 		 * XXX TODO: just make this a callout timer schedule
 		 * so we can flush the FF staging queue if we're
@@ -319,20 +334,27 @@ rtwn_pci_tx_done(struct rtwn_softc *sc, int qid)
 		rtwn_cmd_sleepable(sc, NULL, 0, rtwn_ff_flush_all);
 	}
 #endif
+
+	return (more);
 }
 
-static void
-rtwn_pci_rx_done(struct rtwn_softc *sc)
+static int
+rtwn_pci_rx_done(struct rtwn_softc *sc, int budget)
 {
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
 	struct rtwn_rx_ring *ring = &pc->rx_ring;
 	struct r92ce_rx_stat *rx_desc;
 	struct rtwn_rx_data *rx_data;
-	int len;
+	int len, more = 0;
 
 	bus_dmamap_sync(ring->desc_dmat, ring->desc_map, BUS_DMASYNC_POSTREAD);
 
 	for (;;) {
+		if (budget-- == 0) {
+			more = 1;
+			break;
+		}
+
 		rx_desc = &ring->desc[ring->cur];
 		rx_data = &ring->rx_data[ring->cur];
 
@@ -362,14 +384,14 @@ rtwn_pci_rx_done(struct rtwn_softc *sc)
 		    MJUMPAGESIZE, ring->cur);
 
 		if (!(sc->sc_flags & RTWN_RUNNING))
-			return;
+			return (0);
 
 		/* NB: device can reuse current descriptor. */
 		bus_dmamap_sync(ring->desc_dmat, ring->desc_map,
 		    BUS_DMASYNC_POSTREAD);
 
 		if (le32toh(rx_desc->rxdw0) & R92C_RXDW0_OWN)
-			ring->cur = (ring->cur + 1) % RTWN_PCI_RX_LIST_COUNT;
+			ring->cur = (ring->cur + 1) % ring->count;
 	}
 
 	/* Finished receive; age anything left on the FF queue by a little bump */
@@ -379,9 +401,78 @@ rtwn_pci_rx_done(struct rtwn_softc *sc)
 	 */
 #ifdef  IEEE80211_SUPPORT_SUPERG
 	if (!(sc->sc_flags & RTWN_FW_LOADED) ||
-	    sc->sc_ratectl != RTWN_RATECTL_NET80211)
+	    !RTWN_RATECTL_TXRPT(sc))
 		rtwn_cmd_sleepable(sc, NULL, 0, rtwn_ff_flush_all);
 #endif
+
+	return (more);
+}
+
+static void
+rtwn_pci_intr_rearm(struct rtwn_pci_softc *pc)
+{
+
+	if (pc->pc_intr_holdoff > 0) {
+		/* Keep interrupts masked for a while. */
+		callout_reset_sbt(&pc->pc_holdoff_to,
+		    SBT_1US * pc->pc_intr_holdoff, 0, rtwn_pci_holdoff_to,
+		    &pc->pc_sc, 0);
+	} else
+		rtwn_pci_enable_intr(pc);
+}
+
+void
+rtwn_pci_holdoff_to(void *arg)
+{
+	struct rtwn_softc *sc = arg;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	if (sc->sc_flags & RTWN_RUNNING)
+		rtwn_pci_enable_intr(RTWN_PCI_SOFTC(sc));
+}
+
+void
+rtwn_pci_intr_task(void *arg, int pending)
+{
+	struct rtwn_softc *sc = arg;
+	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
+	int i, status, tx_rings, tag;
+
+	RTWN_LOCK(sc);
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_RX, tag);
+	if (!(sc->sc_flags & RTWN_RUNNING))
+		goto unlock;
+
+	status = pc->pc_pend_status;
+	tx_rings = pc->pc_pend_rings;
+	pc->pc_pend_status = pc->pc_pend_rings = 0;
+
+	if (status & (RTWN_PCI_INTR_RX | RTWN_PCI_INTR_TX_REPORT)) {
+		if (rtwn_pci_rx_done(sc, RTWN_PCI_RX_BUDGET_CUR(pc)))
+			pc->pc_pend_status |= RTWN_PCI_INTR_RX_DONE;
+		else if (pc->pc_rx_boost > 0)
+			pc->pc_rx_boost--;	/* caught up */
+		if (!(sc->sc_flags & RTWN_RUNNING))
+			goto unlock;
+	}
+
+	for (i = 0; i < RTWN_PCI_NTXQUEUES; i++) {
+		if ((tx_rings & (1 << i)) == 0)
+			continue;
+
+		if (rtwn_pci_tx_done(sc, i, MAX(pc->pc_tx_budget, 1)))
+			pc->pc_pend_rings |= (1 << i);
+	}
+
+	if (pc->pc_pend_status != 0 || pc->pc_pend_rings != 0) {
+		/* Budget exhausted; keep interrupts masked. */
+		taskqueue_enqueue(pc->pc_tq, &pc->pc_intr_task);
+	} else
+		rtwn_pci_intr_rearm(pc);
+unlock:
+	RTWN_REGACCT_RESTORE(sc, tag);
+	RTWN_UNLOCK(sc);
 }
 
 void
@@ -389,17 +480,48 @@ rtwn_pci_intr(void *arg)
 {
 	struct rtwn_softc *sc = arg;
 	struct rtwn_pci_softc *pc = RTWN_PCI_SOFTC(sc);
-	int i, status, tx_rings;
+	int i, status, tx_rings, tag;
 
 	RTWN_LOCK(sc);
+	RTWN_REGACCT_SET(sc, RTWN_REGACCT_RX, tag);
 	status = rtwn_pci_get_intr_status(pc, &tx_rings);
 	RTWN_DPRINTF(sc, RTWN_DEBUG_INTR, "%s: status %08X, tx_rings %08X\n",
 	    __func__, status, tx_rings);
+	RTWN_TRACE(sc, INTR, intr, status, tx_rings, 0, 0);
 	if (status == 0 && tx_rings == 0)
 		goto unlock;
 
+	if (status & (RTWN_PCI_INTR_RX_OVERFLOW |
+	    RTWN_PCI_INTR_RX_DESC_UNAVAIL)) {
+		if (status & RTWN_PCI_INTR_RX_OVERFLOW)
+			pc->pc_rx_overflow++;
+		if (status & RTWN_PCI_INTR_RX_DESC_UNAVAIL)
+			pc->pc_rx_desc_unavail++;
+		if (pc->pc_rx_boost < RTWN_PCI_RX_BOOST_MAX)
+			pc->pc_rx_boost++;
+		RTWN_DPRINTF(sc, RTWN_DEBUG_INTR,
+		    "%s: Rx overrun (status %08X), budget %d\n",
+		    __func__, status, RTWN_PCI_RX_BUDGET_CUR(pc));
+
+		/* Make sure the ring will be processed. */
+		status |= RTWN_PCI_INTR_RX;
+	}
+
+	if (pc->pc_intr_poll) {
+		/*
+		 * Interrupts are masked now (by rtwn_pci_get_intr_status());
+		 * defer the work to the taskqueue.
+		 */
+		pc->pc_pend_status |= status;
+		pc->pc_pend_rings |= tx_rings;
+		taskqueue_enqueue(pc->pc_tq, &pc->pc_intr_task);
+		goto unlock;
+	}
+
 	if (status & (RTWN_PCI_INTR_RX | RTWN_PCI_INTR_TX_REPORT)) {
-		rtwn_pci_rx_done(sc);
+		rtwn_pci_rx_done(sc, -1);
+		if (pc->pc_rx_boost > 0)
+			pc->pc_rx_boost--;	/* ring was drained */
 		if (!(sc->sc_flags & RTWN_RUNNING))
 			goto unlock;
 	}
@@ -407,10 +529,11 @@ rtwn_pci_intr(void *arg)
 	if (tx_rings != 0)
 		for (i = 0; i < RTWN_PCI_NTXQUEUES; i++)
 			if (tx_rings & (1 << i))
-				rtwn_pci_tx_done(sc, i);
+				rtwn_pci_tx_done(sc, i, -1);
 
 	if (sc->sc_flags & RTWN_RUNNING)
-		rtwn_pci_enable_intr(pc);
+		rtwn_pci_intr_rearm(pc);
 unlock:
+	RTWN_REGACCT_RESTORE(sc, tag);
 	RTWN_UNLOCK(sc);
 }
@@ -23,5 +23,7 @@ void	rtwn_pci_dma_map_addr(void *, bus_dma_segment_t *, int, int);
 void	rtwn_pci_setup_rx_desc(struct rtwn_pci_softc *,
 	    struct r92ce_rx_stat *, bus_addr_t, size_t, int);
 void	rtwn_pci_intr(void *);
+void	rtwn_pci_intr_task(void *, int);
+void	rtwn_pci_holdoff_to(void *);
 
 #endif	/* RTWN_PCI_RX_H */
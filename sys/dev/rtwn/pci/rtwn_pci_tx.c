@@ -182,6 +182,8 @@ rtwn_pci_tx_start_frame(struct rtwn_softc *sc, struct ieee80211_node *ni,
 
 	ring->cur = (ring->cur + 1) % RTWN_PCI_TX_LIST_COUNT;
 
+	if (ring->queued == 0)
+		ring->last_done = ticks;
 	ring->queued++;
 	if (ring->queued >= (RTWN_PCI_TX_LIST_COUNT - 1))
 		sc->qfullmsk |= (1 << qid);
@@ -26,9 +26,20 @@
 #include <dev/rtwn/rtl8192c/pci/r92ce_rx_desc.h>
 
 
-#define RTWN_PCI_RX_LIST_COUNT		256
+#define RTWN_PCI_RX_LIST_COUNT		256	/* default */
+#define RTWN_PCI_RX_LIST_MIN		32
+#define RTWN_PCI_RX_LIST_MAX		1024
 #define RTWN_PCI_TX_LIST_COUNT		256
 
+/* Per-pass limits for deferred (polled) interrupt processing. */
+#define RTWN_PCI_RX_BUDGET		64
+#define RTWN_PCI_TX_BUDGET		64
+#define RTWN_PCI_RX_BOOST_MAX		3	/* up to 8x Rx budget */
+#define RTWN_PCI_RX_BUDGET_CUR(_pc) \
+	(MAX((_pc)->pc_rx_budget, 1) << (_pc)->pc_rx_boost)
+
+#define RTWN_PCI_TX_RESET_MAX		2	/* per ring, in a row */
+
 /* sizeof(struct rtwn_rx_stat_common) + R88E_INTR_MSG_LEN */
 #define	RTWN_PCI_RX_TMP_BUF_SIZE	84
 
@@ -45,7 +56,8 @@ struct rtwn_rx_ring {
 	bus_dmamap_t		desc_map;
 	bus_dma_tag_t		data_dmat;
 	bus_dma_segment_t	seg;
-	struct rtwn_rx_data	rx_data[RTWN_PCI_RX_LIST_COUNT];
+	struct rtwn_rx_data	*rx_data;
+	int			count;
 	int			cur;
 };
 
@@ -66,6 +78,8 @@ struct rtwn_tx_ring {
 	int			queued;
 	int			cur;
 	int			last;
+	int			last_done;	/* ticks */
+	int			resets;		/* since last completion */
 };
 
 /*
@@ -115,6 +129,20 @@ struct rtwn_pci_softc {
 	void			*pc_ih;
 	bus_size_t		pc_mapsize;
 
+	struct taskqueue	*pc_tq;
+	struct task		pc_intr_task;
+	struct callout		pc_holdoff_to;
+	int			pc_pend_status;
+	int			pc_pend_rings;
+	int			pc_intr_poll;
+	int			pc_intr_holdoff;
+	int			pc_rx_budget;
+	int			pc_rx_boost;	/* budget multiplier, log2 */
+	int			pc_tx_budget;
+	int			pc_rx_ring_size;	/* requested */
+	uint32_t		pc_rx_overflow;
+	uint32_t		pc_rx_desc_unavail;
+
 	uint8_t			pc_rx_buf[RTWN_PCI_RX_TMP_BUF_SIZE];
 	struct rtwn_rx_ring	rx_ring;
 	struct rtwn_tx_ring	tx_ring[RTWN_PCI_NTXQUEUES];
@@ -151,7 +151,7 @@ r88ee_attach(struct rtwn_pci_softc *pc)
 	sc->sc_classify_intr		= r88e_classify_intr;
 	sc->sc_handle_tx_report		= r88e_ratectl_tx_complete;
 	sc->sc_handle_c2h_report	= r88e_handle_c2h_report;
-	sc->sc_check_frame		= rtwn_nop_int_softc_mbuf;
+	sc->sc_check_frame		= rtwn_nop_int_softc_mbuf_desc;
 	sc->sc_rf_read			= r92c_rf_read;
 	sc->sc_rf_write			= r88e_rf_write;
 	sc->sc_check_condition		= r92c_check_condition;
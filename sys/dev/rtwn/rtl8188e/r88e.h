@@ -53,7 +53,7 @@ void	r88e_set_gain(struct rtwn_softc *, uint8_t);
 
 /* r88e_fw.c */
 #ifndef RTWN_WITHOUT_UCODE
-int	r88e_fw_cmd(struct rtwn_softc *, uint8_t, const void *, int);
+int	r88e_fw_cmd(struct rtwn_softc *, uint8_t, const void *, int, int);
 void	r88e_fw_reset(struct rtwn_softc *, int);
 void	r88e_fw_download_enable(struct rtwn_softc *, int);
 #endif
@@ -48,6 +48,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_fw.h>
 
 #include <dev/rtwn/rtl8188e/r88e.h>
 #include <dev/rtwn/rtl8188e/r88e_reg.h>
@@ -56,29 +57,12 @@ __FBSDID("$FreeBSD$");
 
 #ifndef RTWN_WITHOUT_UCODE
 int
-r88e_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len)
+r88e_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len,
+    int key)
 {
 	struct r88e_fw_cmd cmd;
-	int ntries, error;
+	struct rtwn_h2c h2c;
 
-	if (!(sc->sc_flags & RTWN_FW_LOADED)) {
-		RTWN_DPRINTF(sc, RTWN_DEBUG_FIRMWARE, "%s: firmware "
-		    "was not loaded; command (id %d) will be discarded\n",
-		    __func__, id);
-		return (0);
-	}
-
-	/* Wait for current FW box to be empty. */
-	for (ntries = 0; ntries < 50; ntries++) {
-		if (!(rtwn_read_1(sc, R92C_HMETFR) & (1 << sc->fwcur)))
-			break;
-		rtwn_delay(sc, 2000);
-	}
-	if (ntries == 100) {
-		device_printf(sc->sc_dev,
-		    "could not send firmware command\n");
-		return (ETIMEDOUT);
-	}
 	memset(&cmd, 0, sizeof(cmd));
 	cmd.id = id;
 	KASSERT(len <= sizeof(cmd.msg),
@@ -86,20 +70,17 @@ r88e_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len)
 	    __func__, len, sizeof(cmd.msg)));
 	memcpy(cmd.msg, buf, len);
 
-	/* Write the first word last since that will trigger the FW. */
+	memset(&h2c, 0, sizeof(h2c));
+	h2c.id = id;
+	h2c.key = key;
+	h2c.box = *(uint32_t *)&cmd;
 	if (len > 3) {
-		error = rtwn_write_4(sc, R88E_HMEBOX_EXT(sc->fwcur),
-		    *(uint32_t *)((uint8_t *)&cmd + 4));
-		if (error != 0)
-			return (error);
+		h2c.ext = *(uint32_t *)((uint8_t *)&cmd + 4);
+		h2c.ext_reg = R88E_HMEBOX_EXT(0);
+		h2c.ext_len = 4;
 	}
-	error = rtwn_write_4(sc, R92C_HMEBOX(sc->fwcur), *(uint32_t *)&cmd);
-	if (error != 0)
-		return (error);
-
-	sc->fwcur = (sc->fwcur + 1) % R92C_H2C_NBOX;
 
-	return (0);
+	return (rtwn_fw_h2c_submit(sc, &h2c));
 }
 
 void
@@ -166,9 +147,11 @@ r88e_set_media_status(struct rtwn_softc *sc, int macid)
 	    (macid & RTWN_MACID_VALID) != 0);
 
 #ifndef RTWN_WITHOUT_UCODE
-	if (r88e_fw_cmd(sc, R88E_CMD_MSR_RPT, &status, sizeof(status)) != 0) {
-		device_printf(sc->sc_dev, "%s: cannot change media status!\n",
-		    __func__);
+	/* Every media status change must reach the firmware. */
+	if (r88e_fw_cmd(sc, R88E_CMD_MSR_RPT, &status, sizeof(status),
+	    RTWN_H2C_NOMERGE) != 0) {
+		device_printf(sc->sc_dev,
+		    "%s: cannot queue media status change!\n", __func__);
 	}
 #endif
 }
@@ -185,7 +168,8 @@ r88e_set_rsvd_page(struct rtwn_softc *sc, int probe_resp, int null,
 	rsvd.null_data = null;
 	rsvd.null_data_qos = qos_null;
 	rsvd.null_data_qos_bt = 0;
-	return (r88e_fw_cmd(sc, R88E_CMD_RSVD_PAGE, &rsvd, sizeof(rsvd)));
+	return (r88e_fw_cmd(sc, R88E_CMD_RSVD_PAGE, &rsvd, sizeof(rsvd),
+	    RTWN_H2C_NOMERGE));
 }
 
 int
@@ -195,7 +179,8 @@ r88e_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 	struct r88e_fw_cmd_pwrmode mode;
 	int error;
 
-	if (off && vap->iv_state == IEEE80211_S_RUN &&
+	if (off && sc->sc_ps_level != RTWN_PS_AWAKE &&
+	    vap->iv_state == IEEE80211_S_RUN &&
 	    (vap->iv_flags & IEEE80211_F_PMGTON)) {
 		mode.mode = R88E_PWRMODE_LEG;
 		/*
@@ -211,13 +196,16 @@ r88e_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 		mode.mode = R88E_PWRMODE_CAM;
 		mode.pwr_state = R88E_PWRMODE_STATE_ALLON;
 	}
+	/* Sleep longer when the link is idle. */
 	mode.pwrb1 =
 	    SM(R88E_PWRMODE_B1_SMART_PS, R88E_PWRMODE_B1_LEG_NULLDATA) |
-	    SM(R88E_PWRMODE_B1_RLBM, R88E_PWRMODE_B1_MODE_MIN);
+	    SM(R88E_PWRMODE_B1_RLBM, (sc->sc_ps_level == RTWN_PS_DEEP) ?
+	    R88E_PWRMODE_B1_MODE_MAX : R88E_PWRMODE_B1_MODE_MIN);
 	/* XXX ignored */
 	mode.bcn_pass = 0;
 	mode.queue_uapsd = 0;
-	error = r88e_fw_cmd(sc, R88E_CMD_SET_PWRMODE, &mode, sizeof(mode));
+	error = r88e_fw_cmd(sc, R88E_CMD_SET_PWRMODE, &mode, sizeof(mode),
+	    RTWN_H2C_NOMERGE);
 	if (error != 0) {
 		device_printf(sc->sc_dev,
 		    "%s: CMD_SET_PWRMODE was not sent, error %d\n",
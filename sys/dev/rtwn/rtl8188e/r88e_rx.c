@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -49,7 +50,11 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_rc.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
+#include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/rtl8188e/r88e.h>
 #include <dev/rtwn/rtl8188e/r88e_rx_desc.h>
@@ -104,7 +109,7 @@ r88e_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 	    rpt->queue_time_high, rpt->final_rate, rpt->rptb6, rpt->rptb7);
 
 	macid = MS(rpt->rptb1, R88E_RPTB1_MACID);
-	if (macid > sc->macid_limit) {
+	if (macid >= sc->macid_limit) {
 		device_printf(sc->sc_dev,
 		    "macid %u is too big; increase MACID_MAX limit\n",
 		    macid);
@@ -120,6 +125,17 @@ r88e_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 		    (rpt->rptb1 & R88E_RPTB1_PKT_OK) ? "" : " not",
 		    ntries);
 
+		rtwn_stats_tx_status(RTWN_NODE(ni), ntries,
+		    (rpt->rptb1 & R88E_RPTB1_PKT_OK) != 0);
+		RTWN_TRACE(sc, TX_DONE, tx__done, macid, ntries,
+		    (rpt->rptb1 & R88E_RPTB1_PKT_OK) != 0, rpt->final_rate);
+		if (sc->sc_ratectl == RTWN_RATECTL_DRV) {
+			rtwn_rc_tx_complete(sc, ni, ntries,
+			    (rpt->rptb1 & R88E_RPTB1_PKT_OK) != 0,
+			    rpt->final_rate);
+			return;
+		}
+
 #if __FreeBSD_version >= 1200012
 		txs.flags = IEEE80211_RATECTL_STATUS_LONG_RETRY |
 			    IEEE80211_RATECTL_STATUS_FINAL_RATE;
@@ -148,6 +164,8 @@ r88e_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 			    IEEE80211_RATECTL_TX_FAILURE, &ntries, NULL);
 		}
 #endif
+		rtwn_tx_report_update(sc, ni, ntries,
+		    (rpt->rptb1 & R88E_RPTB1_PKT_OK) != 0);
 	} else {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_INTR, "%s: macid %u, ni is NULL\n",
 		    __func__, macid);
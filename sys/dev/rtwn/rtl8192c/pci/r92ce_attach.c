@@ -178,7 +178,7 @@ r92ce_attach(struct rtwn_pci_softc *pc)
 	sc->sc_classify_intr		= r92c_classify_intr;
 	sc->sc_handle_tx_report		= rtwn_nop_softc_uint8_int;
 	sc->sc_handle_c2h_report	= rtwn_nop_softc_uint8_int;
-	sc->sc_check_frame		= rtwn_nop_int_softc_mbuf;
+	sc->sc_check_frame		= rtwn_nop_int_softc_mbuf_desc;
 	sc->sc_rf_read			= r92c_rf_read;
 	sc->sc_rf_write			= r92c_rf_write;
 	sc->sc_check_condition		= r92c_check_condition;
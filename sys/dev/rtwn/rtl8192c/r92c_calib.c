@@ -46,27 +46,33 @@ __FBSDID("$FreeBSD$");
 
 #include <dev/rtwn/if_rtwnreg.h>
 #include <dev/rtwn/if_rtwnvar.h>
+#include <dev/rtwn/if_rtwn_calib.h>
 #include <dev/rtwn/if_rtwn_debug.h>
 
 #include <dev/rtwn/rtl8192c/r92c.h>
 #include <dev/rtwn/rtl8192c/r92c_reg.h>
 
 
+/* BB registers to save and restore during IQ calibration. */
+static const uint16_t r92c_iq_bb_regs[] = {
+	R92C_CCK0_AFESETTING,
+	R92C_OFDM0_TRXPATHENA,
+	R92C_FPGA0_RFIFACESW(0),
+	R92C_FPGA0_RFIFACESW(1),
+	R92C_OFDM0_TRMUXPAR,
+	R92C_FPGA0_RFIFACEOE(0),
+	R92C_FPGA0_RFIFACEOE(1),
+	R92C_CONFIG_ANT(0),
+	R92C_CONFIG_ANT(1)
+};
+
 /* Registers to save and restore during IQ calibration. */
 struct r92c_iq_cal_reg_vals {
 	uint32_t	adda[16];
 	uint8_t		txpause;
 	uint8_t		bcn_ctrl[2];
 	uint32_t	gpio_muxcfg;
-	uint32_t	cck0_afesetting;
-	uint32_t	ofdm0_trxpathena;
-	uint32_t	ofdm0_trmuxpar;
-	uint32_t	fpga0_rfifacesw0;
-	uint32_t	fpga0_rfifacesw1;
-	uint32_t	fpga0_rfifaceoe0;
-	uint32_t	fpga0_rfifaceoe1;
-	uint32_t	config_ant0;
-	uint32_t	config_ant1;
+	uint32_t	bb[nitems(r92c_iq_bb_regs)];
 };
 
 /* XXX TODO: merge */
@@ -148,8 +154,7 @@ r92c_iq_calib_run(struct rtwn_softc *sc, int n, uint16_t tx[2][2],
 	uint32_t hssi_param1;
 
 	if (n == 0) {
-		for (i = 0; i < nitems(reg_adda); i++)
-			vals->adda[i] = rtwn_bb_read(sc, reg_adda[i]);
+		rtwn_regs_save(sc, vals->adda, reg_adda, nitems(reg_adda));
 
 		vals->txpause = rtwn_read_1(sc, R92C_TXPAUSE);
 		vals->bcn_ctrl[0] = rtwn_read_1(sc, R92C_BCN_CTRL(0));
@@ -175,20 +180,8 @@ r92c_iq_calib_run(struct rtwn_softc *sc, int n, uint16_t tx[2][2],
 	}
 
 	if (n == 0) {
-		vals->cck0_afesetting = rtwn_bb_read(sc, R92C_CCK0_AFESETTING);
-		vals->ofdm0_trxpathena =
-		    rtwn_bb_read(sc, R92C_OFDM0_TRXPATHENA);
-		vals->ofdm0_trmuxpar = rtwn_bb_read(sc, R92C_OFDM0_TRMUXPAR);
-		vals->fpga0_rfifacesw0 =
-		    rtwn_bb_read(sc, R92C_FPGA0_RFIFACESW(0));
-		vals->fpga0_rfifacesw1 =
-		    rtwn_bb_read(sc, R92C_FPGA0_RFIFACESW(1));
-		vals->fpga0_rfifaceoe0 =
-		    rtwn_bb_read(sc, R92C_FPGA0_RFIFACEOE(0));
-		vals->fpga0_rfifaceoe1 =
-		    rtwn_bb_read(sc, R92C_FPGA0_RFIFACEOE(1));
-		vals->config_ant0 = rtwn_bb_read(sc, R92C_CONFIG_ANT(0));
-		vals->config_ant1 = rtwn_bb_read(sc, R92C_CONFIG_ANT(1));
+		rtwn_regs_save(sc, vals->bb, r92c_iq_bb_regs,
+		    nitems(r92c_iq_bb_regs));
 	}
 
 	rtwn_bb_setbits(sc, R92C_CCK0_AFESETTING, 0, 0x0f000000);
@@ -266,15 +259,8 @@ r92c_iq_calib_run(struct rtwn_softc *sc, int n, uint16_t tx[2][2],
 		    tx[chain][0], tx[chain][1], rx[chain][0], rx[chain][1]);
 	}
 
-	rtwn_bb_write(sc, R92C_CCK0_AFESETTING, vals->cck0_afesetting);
-	rtwn_bb_write(sc, R92C_OFDM0_TRXPATHENA, vals->ofdm0_trxpathena);
-	rtwn_bb_write(sc, R92C_FPGA0_RFIFACESW(0), vals->fpga0_rfifacesw0);
-	rtwn_bb_write(sc, R92C_FPGA0_RFIFACESW(1), vals->fpga0_rfifacesw1);
-	rtwn_bb_write(sc, R92C_OFDM0_TRMUXPAR, vals->ofdm0_trmuxpar);
-	rtwn_bb_write(sc, R92C_FPGA0_RFIFACEOE(0), vals->fpga0_rfifaceoe0);
-	rtwn_bb_write(sc, R92C_FPGA0_RFIFACEOE(1), vals->fpga0_rfifaceoe1);
-	rtwn_bb_write(sc, R92C_CONFIG_ANT(0), vals->config_ant0);
-	rtwn_bb_write(sc, R92C_CONFIG_ANT(1), vals->config_ant1);
+	rtwn_regs_restore(sc, vals->bb, r92c_iq_bb_regs,
+	    nitems(r92c_iq_bb_regs));
 
 	rtwn_bb_write(sc, R92C_FPGA0_IQK, 0);
 	rtwn_bb_write(sc, R92C_LSSI_PARAM(0), 0x00032ed3);
@@ -287,8 +273,7 @@ r92c_iq_calib_run(struct rtwn_softc *sc, int n, uint16_t tx[2][2],
 			rtwn_bb_write(sc, R92C_HSSI_PARAM1(1), hssi_param1);
 		}
 
-		for (i = 0; i < nitems(reg_adda); i++)
-			rtwn_bb_write(sc, reg_adda[i], vals->adda[i]);
+		rtwn_regs_restore(sc, vals->adda, reg_adda, nitems(reg_adda));
 
 		rtwn_write_1(sc, R92C_TXPAUSE, vals->txpause);
 		rtwn_write_1(sc, R92C_BCN_CTRL(0), vals->bcn_ctrl[0]);
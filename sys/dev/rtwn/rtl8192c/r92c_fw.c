@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -49,9 +50,13 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_fw.h>
+#include <dev/rtwn/if_rtwn_rc.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
 #include <dev/rtwn/if_rtwn_rx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
 #include <dev/rtwn/if_rtwn_task.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 #include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/rtl8192c/r92c.h>
@@ -63,33 +68,16 @@ __FBSDID("$FreeBSD$");
 
 #ifndef RTWN_WITHOUT_UCODE
 static int
-r92c_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len)
+r92c_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len,
+    int key)
 {
 	struct r92c_fw_cmd cmd;
-	int ntries, error;
+	struct rtwn_h2c h2c;
 
 	KASSERT(len <= sizeof(cmd.msg),
 	    ("%s: firmware command too long (%d > %zu)\n",
 	    __func__, len, sizeof(cmd.msg)));
 
-	if (!(sc->sc_flags & RTWN_FW_LOADED)) {
-		RTWN_DPRINTF(sc, RTWN_DEBUG_FIRMWARE, "%s: firmware "
-		    "was not loaded; command (id %u) will be discarded\n",
-		    __func__, id);
-		return (0);
-	}
-
-	/* Wait for current FW box to be empty. */
-	for (ntries = 0; ntries < 50; ntries++) {
-		if (!(rtwn_read_1(sc, R92C_HMETFR) & (1 << sc->fwcur)))
-			break;
-		rtwn_delay(sc, 2000);
-	}
-	if (ntries == 100) {
-		device_printf(sc->sc_dev,
-		    "could not send firmware command\n");
-		return (ETIMEDOUT);
-	}
 	memset(&cmd, 0, sizeof(cmd));
 	cmd.id = id;
 	if (len > 3) {
@@ -100,21 +88,17 @@ r92c_fw_cmd(struct rtwn_softc *sc, uint8_t id, const void *buf, int len)
 	} else
 		memcpy(cmd.msg, buf, len);
 
-	/* Write the first word last since that will trigger the FW. */
+	memset(&h2c, 0, sizeof(h2c));
+	h2c.id = id;
+	h2c.key = key;
+	h2c.box = *(uint32_t *)&cmd;
 	if (len > 3) {
-		error = rtwn_write_2(sc, R92C_HMEBOX_EXT(sc->fwcur),
-		    *(uint16_t *)((uint8_t *)&cmd + 4));
-		if (error != 0)
-			return (error);
+		h2c.ext = *(uint16_t *)((uint8_t *)&cmd + 4);
+		h2c.ext_reg = R92C_HMEBOX_EXT(0);
+		h2c.ext_len = 2;
 	}
-	error = rtwn_write_4(sc, R92C_HMEBOX(sc->fwcur),
-	    *(uint32_t *)&cmd);
-	if (error != 0)
-		return (error);
-
-	sc->fwcur = (sc->fwcur + 1) % R92C_H2C_NBOX;
 
-	return (0);
+	return (rtwn_fw_h2c_submit(sc, &h2c));
 }
 
 void
@@ -206,7 +190,8 @@ r92c_send_ra_cmd(struct rtwn_softc *sc, int macid, uint32_t rates,
 		mode = R92C_RAID_11B;
 	cmd.macid = macid | R92C_CMD_MACID_VALID;
 	cmd.mask = htole32(mode << 28 | rates);
-	error = r92c_fw_cmd(sc, R92C_CMD_MACID_CONFIG, &cmd, sizeof(cmd));
+	error = r92c_fw_cmd(sc, R92C_CMD_MACID_CONFIG, &cmd, sizeof(cmd),
+	    macid);
 	if (error != 0) {
 		device_printf(sc->sc_dev,
 		    "%s: could not set RA mask for %d station\n",
@@ -278,9 +263,11 @@ r92c_joinbss_rpt(struct rtwn_softc *sc, int macid)
 		rs->rs_flags |= R92C_FLAG_ASSOCIATED;
 	}
 
-	if (r92c_fw_cmd(sc, R92C_CMD_JOINBSS_RPT, &cmd, sizeof(cmd)) != 0) {
-		device_printf(sc->sc_dev, "%s: cannot change media status!\n",
-		    __func__);
+	/* Every media status change must reach the firmware. */
+	if (r92c_fw_cmd(sc, R92C_CMD_JOINBSS_RPT, &cmd, sizeof(cmd),
+	    RTWN_H2C_NOMERGE) != 0) {
+		device_printf(sc->sc_dev,
+		    "%s: cannot queue media status change!\n", __func__);
 	}
 
 end:
@@ -302,7 +289,8 @@ r92c_set_rsvd_page(struct rtwn_softc *sc, int probe_resp, int null,
 	rsvd.ps_poll = 0;
 	rsvd.null_data = null;
 
-	return (r92c_fw_cmd(sc, R92C_CMD_RSVD_PAGE, &rsvd, sizeof(rsvd)));
+	return (r92c_fw_cmd(sc, R92C_CMD_RSVD_PAGE, &rsvd, sizeof(rsvd),
+	    RTWN_H2C_NOMERGE));
 }
 
 int
@@ -314,14 +302,18 @@ r92c_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 
 	/* XXX dm_RF_saving */
 
-	if (off && vap->iv_state == IEEE80211_S_RUN &&
-	    (vap->iv_flags & IEEE80211_F_PMGTON))
-		mode.mode = R92C_PWRMODE_MIN;
-	else
+	if (off && sc->sc_ps_level != RTWN_PS_AWAKE &&
+	    vap->iv_state == IEEE80211_S_RUN &&
+	    (vap->iv_flags & IEEE80211_F_PMGTON)) {
+		/* Sleep longer when the link is idle. */
+		mode.mode = (sc->sc_ps_level == RTWN_PS_DEEP) ?
+		    R92C_PWRMODE_MAX : R92C_PWRMODE_MIN;
+	} else
 		mode.mode = R92C_PWRMODE_CAM;
 	mode.smart_ps = R92C_PWRMODE_SMARTPS_NULLDATA;
 	mode.bcn_pass = 1;	/* XXX */
-	error = r92c_fw_cmd(sc, R92C_CMD_SET_PWRMODE, &mode, sizeof(mode));
+	error = r92c_fw_cmd(sc, R92C_CMD_SET_PWRMODE, &mode, sizeof(mode),
+	    RTWN_H2C_NOMERGE);
 	if (error != 0) {
 		device_printf(sc->sc_dev,
 		    "%s: CMD_SET_PWRMODE was not sent, error %d\n",
@@ -331,34 +323,57 @@ r92c_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 	return (error);
 }
 
+/*
+ * Report per-node RSSI to firmware; only nodes with a significant
+ * change are reported, large tables are spread over several rounds.
+ */
 void
 r92c_set_rssi(struct rtwn_softc *sc)
 {
 	struct ieee80211_node *ni;
 	struct rtwn_node *rn;
 	struct r92c_fw_cmd_rssi cmd;
-	int i;
+	int batch, error, i, id, n, pwdb;
 
 	cmd.reserved = 0;
+	n = 0;
+	batch = MIN(sc->sc_rssi_batch, sc->macid_limit);
 
 	RTWN_NT_LOCK(sc);
-	for (i = 0; i < sc->macid_limit; i++) {
-		/* XXX optimize? */
-		ni = sc->node_list[i];
+	for (i = 0; i < sc->macid_limit && n < batch; i++) {
+		id = (sc->sc_rssi_next + i) % sc->macid_limit;
+		ni = sc->node_list[id];
 		if (ni == NULL)
 			continue;
 
 		rn = RTWN_NODE(ni);
-		cmd.macid = i;
-		cmd.pwdb = rn->avg_pwdb;
+		pwdb = rn->avg_pwdb;
+		if (pwdb == -1 || (rn->rpt_pwdb != -1 &&
+		    abs(pwdb - rn->rpt_pwdb) < sc->sc_rssi_delta)) {
+			sc->sc_rssi_skipped++;
+			continue;
+		}
+
+		cmd.macid = id;
+		cmd.pwdb = pwdb;
 		RTWN_DPRINTF(sc, RTWN_DEBUG_RSSI,
 		    "%s: sending RSSI command (macid %d, rssi %d)\n",
-		    __func__, i, rn->avg_pwdb);
+		    __func__, id, pwdb);
 
 		RTWN_NT_UNLOCK(sc);
-		r92c_fw_cmd(sc, R92C_CMD_RSSI_SETTING, &cmd, sizeof(cmd));
+		error = r92c_fw_cmd(sc, R92C_CMD_RSSI_SETTING, &cmd,
+		    sizeof(cmd), id);
 		RTWN_NT_LOCK(sc);
+		if (error != 0)
+			break;	/* queue is full; retry next round */
+
+		/* The node may have gone away meanwhile. */
+		if (sc->node_list[id] == ni)
+			rn->rpt_pwdb = pwdb;
+		n++;
 	}
+	sc->sc_rssi_next = (sc->sc_rssi_next + i) % sc->macid_limit;
+	sc->sc_rssi_sent += n;
 	RTWN_NT_UNLOCK(sc);
 }
 
@@ -373,7 +388,7 @@ r92c_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 	uint8_t macid;
 	int ntries;
 
-	if (sc->sc_ratectl != RTWN_RATECTL_NET80211) {
+	if (!RTWN_RATECTL_TXRPT(sc)) {
 		/* shouldn't happen */
 		device_printf(sc->sc_dev, "%s called while ratectl = %d!\n",
 		    __func__, sc->sc_ratectl);
@@ -396,7 +411,7 @@ r92c_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 	    rpt->rptb7);
 
 	macid = MS(rpt->rptb5, R92C_RPTB5_MACID);
-	if (macid > sc->macid_limit) {
+	if (macid >= sc->macid_limit) {
 		device_printf(sc->sc_dev,
 		    "macid %u is too big; increase MACID_MAX limit\n",
 		    macid);
@@ -413,6 +428,18 @@ r92c_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 		    (rpt->rptb7 & R92C_RPTB7_PKT_OK) ? "" : " not",
 		    ntries);
 
+		rtwn_stats_tx_status(RTWN_NODE(ni), ntries,
+		    (rpt->rptb7 & R92C_RPTB7_PKT_OK) != 0);
+		RTWN_TRACE(sc, TX_DONE, tx__done, macid, ntries,
+		    (rpt->rptb7 & R92C_RPTB7_PKT_OK) != 0, RTWN_RIDX_UNKNOWN);
+		if (sc->sc_ratectl == RTWN_RATECTL_DRV) {
+			rtwn_rc_tx_complete(sc, ni, ntries,
+			    (rpt->rptb7 & R92C_RPTB7_PKT_OK) != 0,
+			    RTWN_RIDX_UNKNOWN);
+			RTWN_NT_UNLOCK(sc);
+			return;
+		}
+
 #if __FreeBSD_version >= 1200012
 		txs.flags = IEEE80211_RATECTL_STATUS_LONG_RETRY;
 		txs.long_retries = ntries;
@@ -435,6 +462,8 @@ r92c_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 			    IEEE80211_RATECTL_TX_FAILURE, &ntries, NULL);
 		}
 #endif
+		rtwn_tx_report_update(sc, ni, ntries,
+		    (rpt->rptb7 & R92C_RPTB7_PKT_OK) != 0);
 	} else {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_INTR, "%s: macid %u, ni is NULL\n",
 		    __func__, macid);
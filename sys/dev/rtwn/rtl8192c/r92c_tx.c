@@ -227,12 +227,13 @@ r92c_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	struct r92c_tx_desc *txd;
 	enum ieee80211_protmode prot;
 	uint8_t type, tid, qos, qsel;
-	int hasqos, ismcast, macid;
+	int hasqos, ismcast, macid, drvrate;
 
 	wh = mtod(m, struct ieee80211_frame *);
 	type = wh->i_fc[0] & IEEE80211_FC0_TYPE_MASK;
 	hasqos = IEEE80211_QOS_HAS_SEQ(wh);
 	ismcast = IEEE80211_IS_MULTICAST(wh->i_addr1);
+	drvrate = 0;
 
 	/* Select TX ring for this frame. */
 	if (hasqos) {
@@ -259,7 +260,12 @@ r92c_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 		}
 
 		struct rtwn_node *un = RTWN_NODE(ni);
-		macid = un->id;
+		if (RTWN_NODE_SHARED(un)) {
+			/* No MACID; use driver-side rate control. */
+			macid = RTWN_MACID_BC;
+			drvrate = 1;
+		} else
+			macid = un->id;
 
 		if (type == IEEE80211_FC0_TYPE_DATA) {
 			qsel = tid % RTWN_MAX_TID;
@@ -267,12 +273,16 @@ r92c_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 			rtwn_r92c_tx_enable_ampdu(sc, buf,
 			    (m->m_flags & M_AMPDU_MPDU) != 0);
 			if (m->m_flags & M_AMPDU_MPDU) {
+				int density, maxagg;
+
+				rtwn_tx_ampdu_setup(sc, ni, m, tid, ridx,
+				    &density, &maxagg);
 				txd->txdw2 |= htole32(SM(R92C_TXDW2_AMPDU_DEN,
-				    vap->iv_ampdu_density));
+				    density));
 				txd->txdw6 |= htole32(SM(R92C_TXDW6_MAX_AGG,
-				    0x1f));	/* XXX */
+				    maxagg));
 			}
-			if (sc->sc_ratectl == RTWN_RATECTL_NET80211) {
+			if (rtwn_tx_report_request(sc, ni, ridx)) {
 				txd->txdw2 |= htole32(R92C_TXDW2_CCX_RPT);
 				sc->sc_tx_n_active++;
 #ifndef RTWN_WITHOUT_UCODE
@@ -319,7 +329,7 @@ r92c_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	r92c_tx_raid(sc, txd, ni, ismcast);
 
 	/* Force this rate if needed. */
-	if (sc->sc_ratectl != RTWN_RATECTL_FW)
+	if (sc->sc_ratectl != RTWN_RATECTL_FW || drvrate)
 		txd->txdw4 |= htole32(R92C_TXDW4_DRVRATE);
 
 	if (!hasqos) {
@@ -126,7 +126,8 @@ void	r12a_parse_rom(struct rtwn_softc *, uint8_t *);
 /* r12a_rx.c */
 void	r12a_ratectl_tx_complete(struct rtwn_softc *, uint8_t *, int);
 void	r12a_handle_c2h_report(struct rtwn_softc *, uint8_t *, int);
-int	r12a_check_frame_checksum(struct rtwn_softc *, struct mbuf *);
+int	r12a_check_frame_checksum(struct rtwn_softc *, struct mbuf *,
+	    const void *);
 uint8_t	r12a_rx_radiotap_flags(const void *);
 
 /* r12a_tx.c */
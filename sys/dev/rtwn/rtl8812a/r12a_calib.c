@@ -53,6 +53,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnreg.h>
 #include <dev/rtwn/if_rtwnvar.h>
 
+#include <dev/rtwn/if_rtwn_calib.h>
 #include <dev/rtwn/if_rtwn_debug.h>
 
 #include <dev/rtwn/rtl8812a/r12a.h>
@@ -130,26 +131,22 @@ void
 r12a_save_bb_afe_vals(struct rtwn_softc *sc, uint32_t vals[],
     const uint16_t regs[], int size)
 {
-	int i;
 
 	/* Select page C. */
 	rtwn_bb_setbits(sc, R12A_TXAGC_TABLE_SELECT, 0x80000000, 0);
 
-	for (i = 0; i < size; i++)
-		vals[i] = rtwn_bb_read(sc, regs[i]);
+	rtwn_regs_save(sc, vals, regs, size);
 }
 
 void
 r12a_restore_bb_afe_vals(struct rtwn_softc *sc, uint32_t vals[],
     const uint16_t regs[], int size)
 {
-	int i;
 
 	/* Select page C. */
 	rtwn_bb_setbits(sc, R12A_TXAGC_TABLE_SELECT, 0x80000000, 0);
 
-	for (i = 0; i < size; i++)
-		rtwn_bb_write(sc, regs[i], vals[i]);
+	rtwn_regs_restore(sc, vals, regs, size);
 }
 
 void
@@ -111,9 +111,13 @@ r12a_set_media_status(struct rtwn_softc *sc, int macid)
 	status.macid = (macid & ~RTWN_MACID_VALID);
 	status.macid_end = 0;
 
-	error = r88e_fw_cmd(sc, R12A_CMD_MSR_RPT, &status, sizeof(status));
-	if (error != 0)
-		device_printf(sc->sc_dev, "cannot change media status!\n");
+	/* Every media status change must reach the firmware. */
+	error = r88e_fw_cmd(sc, R12A_CMD_MSR_RPT, &status, sizeof(status),
+	    RTWN_H2C_NOMERGE);
+	if (error != 0) {
+		device_printf(sc->sc_dev,
+		    "cannot queue media status change!\n");
+	}
 }
 
 int
@@ -123,7 +127,8 @@ r12a_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 	struct r12a_fw_cmd_pwrmode mode;
 	int error;
 
-	if (off && vap->iv_state == IEEE80211_S_RUN &&
+	if (off && sc->sc_ps_level != RTWN_PS_AWAKE &&
+	    vap->iv_state == IEEE80211_S_RUN &&
 	    (vap->iv_flags & IEEE80211_F_PMGTON)) {
 		mode.mode = R88E_PWRMODE_LEG;
 		/*
@@ -139,14 +144,17 @@ r12a_set_pwrmode(struct rtwn_softc *sc, struct ieee80211vap *vap,
 		mode.mode = R88E_PWRMODE_CAM;
 		mode.pwr_state = R88E_PWRMODE_STATE_ALLON;
 	}
+	/* Sleep longer when the link is idle. */
 	mode.pwrb1 =
 	    SM(R88E_PWRMODE_B1_SMART_PS, R88E_PWRMODE_B1_LEG_NULLDATA) |
-	    SM(R88E_PWRMODE_B1_RLBM, R88E_PWRMODE_B1_MODE_MIN);
+	    SM(R88E_PWRMODE_B1_RLBM, (sc->sc_ps_level == RTWN_PS_DEEP) ?
+	    R88E_PWRMODE_B1_MODE_MAX : R88E_PWRMODE_B1_MODE_MIN);
 	/* XXX ignored */
 	mode.bcn_pass = 0;
 	mode.queue_uapsd = 0;
 	mode.pwrb5 = R12A_PWRMODE_B5_NO_BTCOEX;
-	error = r88e_fw_cmd(sc, R12A_CMD_SET_PWRMODE, &mode, sizeof(mode));
+	error = r88e_fw_cmd(sc, R12A_CMD_SET_PWRMODE, &mode, sizeof(mode),
+	    RTWN_H2C_NOMERGE);
 	if (error != 0) {
 		device_printf(sc->sc_dev,
 		    "%s: CMD_SET_PWRMODE was not sent, error %d\n",
@@ -183,7 +191,8 @@ r12a_iq_calib_fw(struct rtwn_softc *sc)
 	cmd.ext_5g_pa_lna = RTWN_CMD_IQ_EXT_PA_5G(rs->ext_pa_5g);
 	cmd.ext_5g_pa_lna |= RTWN_CMD_IQ_EXT_LNA_5G(rs->ext_lna_5g);
 
-	if (r88e_fw_cmd(sc, R12A_CMD_IQ_CALIBRATE, &cmd, sizeof(cmd)) != 0) {
+	if (r88e_fw_cmd(sc, R12A_CMD_IQ_CALIBRATE, &cmd, sizeof(cmd),
+	    RTWN_H2C_NOMERGE) != 0) {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_CALIB,
 		    "error while sending IQ calibration command to FW!\n");
 		return;
@@ -38,6 +38,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -55,7 +56,11 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_rc.h>
 #include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
+#include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/rtl8812a/r12a.h>
 #include <dev/rtwn/rtl8812a/r12a_var.h>
@@ -93,7 +98,7 @@ r12a_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 	    rpt->queue_time_low, rpt->queue_time_high, rpt->final_rate,
 	    rpt->reserved);
 
-	if (rpt->macid > sc->macid_limit) {
+	if (rpt->macid >= sc->macid_limit) {
 		device_printf(sc->sc_dev,
 		    "macid %u is too big; increase MACID_MAX limit\n",
 		    rpt->macid);
@@ -109,6 +114,19 @@ r12a_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 		    (rpt->txrptb0 & (R12A_TXRPTB0_RETRY_OVER |
 		    R12A_TXRPTB0_LIFE_EXPIRE)) ? " not" : "", ntries);
 
+		rtwn_stats_tx_status(RTWN_NODE(ni), ntries,
+		    (rpt->txrptb0 & (R12A_TXRPTB0_RETRY_OVER |
+		    R12A_TXRPTB0_LIFE_EXPIRE)) == 0);
+		RTWN_TRACE(sc, TX_DONE, tx__done, rpt->macid, ntries,
+		    (rpt->txrptb0 & (R12A_TXRPTB0_RETRY_OVER |
+		    R12A_TXRPTB0_LIFE_EXPIRE)) == 0, rpt->final_rate);
+		if (sc->sc_ratectl == RTWN_RATECTL_DRV) {
+			rtwn_rc_tx_complete(sc, ni, ntries,
+			    (rpt->txrptb0 & (R12A_TXRPTB0_RETRY_OVER |
+			    R12A_TXRPTB0_LIFE_EXPIRE)) == 0, rpt->final_rate);
+			return;
+		}
+
 #if __FreeBSD_version >= 1200012
 		txs.flags = IEEE80211_RATECTL_STATUS_LONG_RETRY |
 			    IEEE80211_RATECTL_STATUS_FINAL_RATE;
@@ -135,6 +153,9 @@ r12a_ratectl_tx_complete(struct rtwn_softc *sc, uint8_t *buf, int len)
 			    IEEE80211_RATECTL_TX_SUCCESS, &ntries, NULL);
 		}
 #endif
+		rtwn_tx_report_update(sc, ni, ntries,
+		    (rpt->txrptb0 & (R12A_TXRPTB0_RETRY_OVER |
+		    R12A_TXRPTB0_LIFE_EXPIRE)) == 0);
 	} else {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_INTR,
 		    "%s: macid %u, ni is NULL\n", __func__, rpt->macid);
@@ -191,13 +212,13 @@ r12a_handle_c2h_report(struct rtwn_softc *sc, uint8_t *buf, int len)
 #endif
 
 int
-r12a_check_frame_checksum(struct rtwn_softc *sc, struct mbuf *m)
+r12a_check_frame_checksum(struct rtwn_softc *sc, struct mbuf *m,
+    const void *desc)
 {
 	struct r12a_softc *rs = sc->sc_priv;
-	struct r92c_rx_stat *stat;
+	const struct r92c_rx_stat *stat = desc;
 	uint32_t rxdw1;
 
-	stat = mtod(m, struct r92c_rx_stat *);
 	rxdw1 = le32toh(stat->rxdw1);
 	if (rxdw1 & R12A_RXDW1_CKSUM) {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_RECV,
@@ -54,6 +54,7 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/if_rtwnvar.h>
 
 #include <dev/rtwn/if_rtwn_ridx.h>
+#include <dev/rtwn/if_rtwn_tx.h>
 
 #include <dev/rtwn/rtl8812a/r12a.h>
 #include <dev/rtwn/rtl8812a/r12a_tx_desc.h>
@@ -225,12 +226,13 @@ r12a_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	struct r12a_tx_desc *txd;
 	enum ieee80211_protmode prot;
 	uint8_t type, tid, qos, qsel;
-	int hasqos, ismcast, macid;
+	int hasqos, ismcast, macid, drvrate;
 
 	wh = mtod(m, struct ieee80211_frame *);
 	type = wh->i_fc[0] & IEEE80211_FC0_TYPE_MASK;
 	hasqos = IEEE80211_QOS_HAS_SEQ(wh);
 	ismcast = IEEE80211_IS_MULTICAST(wh->i_addr1);
+	drvrate = 0;
 
 	/* Select TX ring for this frame. */
 	if (hasqos) {
@@ -257,21 +259,30 @@ r12a_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 		}
 
 		struct rtwn_node *un = RTWN_NODE(ni);
-		macid = un->id;
+		if (RTWN_NODE_SHARED(un)) {
+			/* No MACID; use driver-side rate control. */
+			macid = RTWN_MACID_BC;
+			drvrate = 1;
+		} else
+			macid = un->id;
 
 		if (type == IEEE80211_FC0_TYPE_DATA) {
 			qsel = tid % RTWN_MAX_TID;
 
 			if (m->m_flags & M_AMPDU_MPDU) {
+				int density, maxagg;
+
+				rtwn_tx_ampdu_setup(sc, ni, m, tid, ridx,
+				    &density, &maxagg);
 				txd->txdw2 |= htole32(R12A_TXDW2_AGGEN);
 				txd->txdw2 |= htole32(SM(R12A_TXDW2_AMPDU_DEN,
-				    vap->iv_ampdu_density));
+				    density));
 				txd->txdw3 |= htole32(SM(R12A_TXDW3_MAX_AGG,
-				    0x1f));	/* XXX */
+				    maxagg));
 			} else
 				txd->txdw2 |= htole32(R12A_TXDW2_AGGBK);
 
-			if (sc->sc_ratectl == RTWN_RATECTL_NET80211) {
+			if (rtwn_tx_report_request(sc, ni, ridx)) {
 				txd->txdw2 |= htole32(R12A_TXDW2_SPE_RPT);
 				sc->sc_tx_n_active++;
 			}
@@ -314,7 +325,7 @@ r12a_fill_tx_desc(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	r12a_tx_raid(sc, txd, ni, ismcast);
 
 	/* Force this rate if needed. */
-	if (sc->sc_ratectl != RTWN_RATECTL_FW)
+	if (sc->sc_ratectl != RTWN_RATECTL_FW || drvrate)
 		txd->txdw3 |= htole32(R12A_TXDW3_DRVRATE);
 
 	if (!hasqos) {
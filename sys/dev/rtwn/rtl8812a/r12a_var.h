@@ -43,6 +43,15 @@ struct r12a_softc {
 
 	int			rs_radar;
 	struct timeout_task	rs_chan_check;
+	int			rs_radar_cac_ms;	/* poll period in CAC */
+	int			rs_radar_run_ms;	/* ... in service */
+	int			rs_radar_confirm;
+	int			rs_radar_pending;
+	uint32_t		rs_radar_polls;
+	uint32_t		rs_radar_pulses;
+	uint32_t		rs_radar_events;
+	uint32_t		rs_radar_false;
+	uint32_t		rs_radar_resets;
 
 	/* ROM variables */
 	int			ext_pa_2g:1,
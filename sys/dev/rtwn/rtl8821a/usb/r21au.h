@@ -32,6 +32,30 @@
 #include <dev/rtwn/rtl8821a/r21a.h>
 
 
+/*
+ * Radar check periods.
+ */
+#define R21AU_RADAR_CAC_MS	200
+#define R21AU_RADAR_RUN_MS	2000
+
+/*
+ * Radar detector BB registers.
+ */
+#define R21AU_RADAR_CTL		0x924
+#define R21AU_RADAR_CTL_EN	0x00008000
+#define R21AU_RADAR_STATUS	0xf98
+#define R21AU_RADAR_STATUS_DET	0x00020000
+
+/*
+ * Radar check results (see r21au_dfs_check()).
+ */
+#define R21AU_RADAR_OFF		0	/* detection was turned off */
+#define R21AU_RADAR_NONE	1
+#define R21AU_RADAR_PULSE	2	/* wait for confirmation */
+#define R21AU_RADAR_FALSE	3	/* pulse was not confirmed */
+#define R21AU_RADAR_DETECTED	4
+
+
 /*
  * Function declarations.
  */
@@ -40,9 +64,12 @@ void	r21au_init_tx_agg(struct rtwn_softc *);
 void	r21au_init_burstlen(struct rtwn_softc *);
 
 /* r21au_dfs.c */
+int	r21au_dfs_check(uint32_t, uint32_t, int, int *);
+int	r21au_dfs_poll_ms(int, int, int, int);
 void	r21au_chan_check(void *, int);
 int	r21au_newstate(struct ieee80211vap *, enum ieee80211_state, int);
 void	r21au_scan_start(struct ieee80211com *);
 void	r21au_scan_end(struct ieee80211com *);
+int	r21au_sysctl_radar_stats(SYSCTL_HANDLER_ARGS);
 
 #endif	/* RTL8821AU_H */
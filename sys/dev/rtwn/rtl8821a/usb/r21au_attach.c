@@ -30,6 +30,7 @@ __FBSDID("$FreeBSD$");
 #include "opt_wlan.h"
 
 #include <sys/param.h>
+#include <sys/sysctl.h>
 #include <sys/lock.h>
 #include <sys/mutex.h>
 #include <sys/mbuf.h>
@@ -131,6 +132,22 @@ r21a_attach_private(struct rtwn_softc *sc)
 	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
 	    "radar_detection", CTLFLAG_RDTUN, &rs->rs_radar,
 	    rs->rs_radar, "Enable radar detection (untested)");
+	rs->rs_radar_cac_ms = R21AU_RADAR_CAC_MS;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "radar_cac_period", CTLFLAG_RWTUN, &rs->rs_radar_cac_ms,
+	    rs->rs_radar_cac_ms, "Radar check period during CAC (ms)");
+	rs->rs_radar_run_ms = R21AU_RADAR_RUN_MS;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "radar_period", CTLFLAG_RWTUN, &rs->rs_radar_run_ms,
+	    rs->rs_radar_run_ms, "Radar check period in service (ms)");
+	rs->rs_radar_confirm = 0;
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "radar_confirm", CTLFLAG_RWTUN, &rs->rs_radar_confirm,
+	    rs->rs_radar_confirm,
+	    "Report radar only if detected on two consecutive checks");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "radar_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, sc,
+	    0, r21au_sysctl_radar_stats, "A", "Radar detection statistics");
 
 	rs->rs_fix_spur			= rtwn_nop_softc_chan;
 	rs->rs_set_band_2ghz		= r21a_set_band_2ghz;
@@ -30,6 +30,8 @@ __FBSDID("$FreeBSD$");
 #include "opt_wlan.h"
 
 #include <sys/param.h>
+#include <sys/sysctl.h>
+#include <sys/sbuf.h>
 #include <sys/lock.h>
 #include <sys/mutex.h>
 #include <sys/mbuf.h>
@@ -61,18 +63,13 @@ __FBSDID("$FreeBSD$");
 #include <dev/rtwn/rtl8821a/usb/r21au_reg.h>
 
 
-#define R21AU_RADAR_CHECK_PERIOD	(2 * hz)
+static int	r21au_dfs_cac_running(struct rtwn_softc *);
+static void	r21au_dfs_schedule(struct rtwn_softc *, int);
 
 static void
 r21au_dfs_radar_disable(struct rtwn_softc *sc)
 {
-	rtwn_bb_setbits(sc, 0x924, 0x00008000, 0);
-}
-
-static int
-r21au_dfs_radar_is_enabled(struct rtwn_softc *sc)
-{
-	return !!(rtwn_bb_read(sc, 0x924) & 0x00008000);
+	rtwn_bb_setbits(sc, R21AU_RADAR_CTL, R21AU_RADAR_CTL_EN, 0);
 }
 
 static int
@@ -80,11 +77,13 @@ r21au_dfs_radar_reset(struct rtwn_softc *sc)
 {
 	int error;
 
-	error = rtwn_bb_setbits(sc, 0x924, 0x00008000, 0);
+	R12A_SOFTC(sc)->rs_radar_resets++;
+
+	error = rtwn_bb_setbits(sc, R21AU_RADAR_CTL, R21AU_RADAR_CTL_EN, 0);
 	if (error != 0)
 		return (error);
 
-	return (rtwn_bb_setbits(sc, 0x924, 0, 0x00008000));
+	return (rtwn_bb_setbits(sc, R21AU_RADAR_CTL, 0, R21AU_RADAR_CTL_EN));
 }
 
 static int
@@ -110,9 +109,78 @@ r21au_dfs_radar_enable(struct rtwn_softc *sc)
 }
 
 static int
-r21au_dfs_radar_is_detected(struct rtwn_softc *sc)
+r21au_dfs_cac_running(struct rtwn_softc *sc)
+{
+	int i;
+
+	for (i = 0; i < RTWN_PORT_COUNT; i++) {
+		if (sc->vaps[i] != NULL &&
+		    sc->vaps[i]->vap.iv_state == IEEE80211_S_CAC)
+			return (1);
+	}
+
+	return (0);
+}
+
+/*
+ * The radar detector of this chip is undocumented: there is no model
+ * of it (or of the BB register file) to run the driver against, and
+ * no test harness for rtwn at all.  The decisions below therefore
+ * take register samples and the previous state only and do no I/O,
+ * so they can be checked against recorded register traces.
+ */
+
+/*
+ * Evaluate one poll of the CTL / STATUS registers; 'status' is
+ * ignored when detection is off.  '*pending' is set while a pulse
+ * waits for confirmation by the next poll.
+ */
+int
+r21au_dfs_check(uint32_t ctl, uint32_t status, int confirm, int *pending)
+{
+
+	if (!(ctl & R21AU_RADAR_CTL_EN))
+		return (R21AU_RADAR_OFF);
+
+	if (status & R21AU_RADAR_STATUS_DET) {
+		if (confirm && !*pending) {
+			*pending = 1;
+			return (R21AU_RADAR_PULSE);
+		}
+		*pending = 0;
+		return (R21AU_RADAR_DETECTED);
+	}
+
+	if (*pending) {
+		*pending = 0;
+		return (R21AU_RADAR_FALSE);
+	}
+
+	return (R21AU_RADAR_NONE);
+}
+
+/*
+ * No radar interrupt / C2H event is known for this chip, so poll;
+ * CAC (and a pending confirmation) needs a short detection latency,
+ * in service a longer period saves USB bandwidth.
+ */
+int
+r21au_dfs_poll_ms(int cac, int pending, int cac_ms, int run_ms)
 {
-	return !!(rtwn_bb_read(sc, 0xf98) & 0x00020000);
+
+	return ((cac || pending) ? cac_ms : run_ms);
+}
+
+static void
+r21au_dfs_schedule(struct rtwn_softc *sc, int cac)
+{
+	struct r12a_softc *rs = sc->sc_priv;
+	int ms;
+
+	ms = r21au_dfs_poll_ms(cac, rs->rs_radar_pending,
+	    rs->rs_radar_cac_ms, rs->rs_radar_run_ms);
+	taskqueue_enqueue_timeout(taskqueue_thread, &rs->rs_chan_check,
+	    MAX(1, msecs_to_ticks(ms)));
 }
 
 void
@@ -121,14 +189,23 @@ r21au_chan_check(void *arg, int npending __unused)
 	struct rtwn_softc *sc = arg;
 	struct r12a_softc *rs = sc->sc_priv;
 	struct ieee80211com *ic = &sc->sc_ic;
+	uint32_t ctl, status;
 
 	RTWN_LOCK(sc);
 #ifdef DIAGNOSTIC
 	RTWN_DPRINTF(sc, RTWN_DEBUG_STATE,
 	    "%s: periodical radar detection task\n", __func__);
 #endif
+	rs->rs_radar_polls++;
+
+	ctl = rtwn_bb_read(sc, R21AU_RADAR_CTL);
+	status = 0;
+	if (ctl & R21AU_RADAR_CTL_EN)
+		status = rtwn_bb_read(sc, R21AU_RADAR_STATUS);
 
-	if (!r21au_dfs_radar_is_enabled(sc)) {
+	switch (r21au_dfs_check(ctl, status, rs->rs_radar_confirm,
+	    &rs->rs_radar_pending)) {
+	case R21AU_RADAR_OFF:
 		if (rs->rs_flags & R12A_RADAR_ENABLED) {
 			/* should not happen */
 			device_printf(sc->sc_dev,
@@ -140,10 +217,18 @@ r21au_chan_check(void *arg, int npending __unused)
 		}
 		RTWN_UNLOCK(sc);
 		return;
-	}
+	case R21AU_RADAR_PULSE:
+		r21au_dfs_radar_reset(sc);
+		rs->rs_radar_pulses++;
 
-	if (r21au_dfs_radar_is_detected(sc)) {
+		/* Check again soon. */
+		RTWN_DPRINTF(sc, RTWN_DEBUG_RADAR,
+		    "%s: radar pulse, waiting for confirmation\n", __func__);
+		break;
+	case R21AU_RADAR_DETECTED:
 		r21au_dfs_radar_reset(sc);
+		rs->rs_radar_pulses++;
+		rs->rs_radar_events++;
 
 		RTWN_DPRINTF(sc, RTWN_DEBUG_RADAR, "%s: got radar event\n",
 		    __func__);
@@ -155,12 +240,18 @@ r21au_chan_check(void *arg, int npending __unused)
 
 		IEEE80211_UNLOCK(ic);
 		RTWN_LOCK(sc);
+		break;
+	case R21AU_RADAR_FALSE:
+		RTWN_DPRINTF(sc, RTWN_DEBUG_RADAR,
+		    "%s: radar pulse was not confirmed\n", __func__);
+		rs->rs_radar_false++;
+		break;
+	default:
+		break;
 	}
 
-	if (rs->rs_flags & R12A_RADAR_ENABLED) {
-		taskqueue_enqueue_timeout(taskqueue_thread,
-		    &rs->rs_chan_check, R21AU_RADAR_CHECK_PERIOD);
-	}
+	if (rs->rs_flags & R12A_RADAR_ENABLED)
+		r21au_dfs_schedule(sc, r21au_dfs_cac_running(sc));
 	RTWN_UNLOCK(sc);
 }
 
@@ -193,8 +284,8 @@ r21au_newstate(struct ieee80211vap *vap, enum ieee80211_state nstate, int arg)
 		RTWN_DPRINTF(sc, RTWN_DEBUG_RADAR,
 		    "%s: radar detection was enabled\n", __func__);
 
-		taskqueue_enqueue_timeout(taskqueue_thread,
-		    &rs->rs_chan_check, R21AU_RADAR_CHECK_PERIOD);
+		rs->rs_radar_pending = 0;
+		r21au_dfs_schedule(sc, 1);
 	}
 
 	if ((nstate < IEEE80211_S_CAC || nstate == IEEE80211_S_CSA) &&
@@ -271,10 +362,37 @@ r21au_scan_end(struct ieee80211com *ic)
 		RTWN_DPRINTF(sc, RTWN_DEBUG_RADAR,
 		    "%s: radar detection was re-enabled\n", __func__);
 
-		taskqueue_enqueue_timeout(taskqueue_thread,
-		    &rs->rs_chan_check, R21AU_RADAR_CHECK_PERIOD);
+		rs->rs_radar_pending = 0;
+		r21au_dfs_schedule(sc, r21au_dfs_cac_running(sc));
 	}
 	RTWN_UNLOCK(sc);
 
 	rs->rs_scan_end(ic);
 }
+
+int
+r21au_sysctl_radar_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_softc *sc = arg1;
+	struct r12a_softc *rs = sc->sc_priv;
+	uint32_t polls, pulses, events, false_pos, resets;
+	struct sbuf sb;
+	int error;
+
+	RTWN_LOCK(sc);
+	polls = rs->rs_radar_polls;
+	pulses = rs->rs_radar_pulses;
+	events = rs->rs_radar_events;
+	false_pos = rs->rs_radar_false;
+	resets = rs->rs_radar_resets;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "%u checks, %u pulses, %u events, "
+	    "%u false positives, %u resets", polls, pulses, events,
+	    false_pos, resets);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
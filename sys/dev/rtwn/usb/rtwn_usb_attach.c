@@ -23,6 +23,7 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/sysctl.h>
+#include <sys/sbuf.h>
 #include <sys/lock.h>
 #include <sys/mutex.h>
 #include <sys/mbuf.h>
@@ -35,6 +36,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/endian.h>
 #include <sys/linker.h>
 #include <sys/kdb.h>
+#include <sys/sdt.h>
 
 #include <net/if.h>
 #include <net/if_var.h>
@@ -49,6 +51,7 @@ __FBSDID("$FreeBSD$");
 
 #include <dev/rtwn/if_rtwnvar.h>
 #include <dev/rtwn/if_rtwn_nop.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 
 #include <dev/rtwn/usb/rtwn_usb_var.h>
 
@@ -83,6 +86,11 @@ static int	rtwn_usb_fw_write_block(struct rtwn_softc *,
 		    const uint8_t *, uint16_t, int);
 static void	rtwn_usb_drop_incorrect_tx(struct rtwn_softc *);
 static void	rtwn_usb_attach_methods(struct rtwn_softc *);
+#ifdef RTWN_DEBUG
+static int	rtwn_usb_sysctl_rx_stats(SYSCTL_HANDLER_ARGS);
+static int	rtwn_usb_sysctl_tx_stats(SYSCTL_HANDLER_ARGS);
+static void	rtwn_usb_sysctlattach(struct rtwn_usb_softc *);
+#endif
 
 #define RTWN_CONFIG_INDEX	0
 
@@ -310,11 +318,15 @@ rtwn_usb_attach_methods(struct rtwn_softc *sc)
 	sc->sc_read_1		= rtwn_usb_read_1;
 	sc->sc_read_2		= rtwn_usb_read_2;
 	sc->sc_read_4		= rtwn_usb_read_4;
+	sc->sc_read_region	= rtwn_usb_read_region_1;
+	sc->sc_write_region	= rtwn_usb_write_region;
 	sc->sc_delay		= rtwn_usb_delay;
 	sc->sc_tx_start		= rtwn_usb_tx_start;
 	sc->sc_start_xfers	= rtwn_usb_start_xfers;
 	sc->sc_reset_lists	= rtwn_usb_reset_lists;
+	sc->sc_resize_lists	= rtwn_nop_softc;
 	sc->sc_abort_xfers	= rtwn_usb_abort_xfers;
+	sc->sc_tx_recover	= rtwn_usb_tx_recover;
 	sc->sc_fw_write_block	= rtwn_usb_fw_write_block;
 	sc->sc_get_qmap		= rtwn_usb_get_qmap;
 	sc->sc_set_desc_addr	= rtwn_nop_softc;
@@ -326,6 +338,86 @@ rtwn_usb_attach_methods(struct rtwn_softc *sc)
 	sc->bcn_check_interval	= 100;
 }
 
+#ifdef RTWN_DEBUG
+static int
+rtwn_usb_sysctl_rx_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct rtwn_usb_softc *uc = arg1;
+	struct rtwn_softc *sc = &uc->uc_sc;
+	struct rtwn_usb_rx_stats rs;
+	struct sbuf sb;
+	int error;
+
+	RTWN_LOCK(sc);
+	rs = uc->uc_rx_stats;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "%ju xfers, %ju frames, %ju bytes, "
+	    "%ju truncated, max %u frames/xfer, %ju us",
+	    (uintmax_t)rs.xfers, (uintmax_t)rs.frames, (uintmax_t)rs.bytes,
+	    (uintmax_t)rs.truncated, rs.agg_max, (uintmax_t)rs.usec);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
+
+static int
+rtwn_usb_sysctl_tx_stats(SYSCTL_HANDLER_ARGS)
+{
+	static const char *qname[RTWN_N_TRANSFER] =
+	    { NULL, "BE", "BK", "VI", "VO" };
+	struct rtwn_usb_softc *uc = arg1;
+	struct rtwn_softc *sc = &uc->uc_sc;
+	struct rtwn_usb_tx_stats ts;
+	struct sbuf sb;
+	int error, i;
+
+	RTWN_LOCK(sc);
+	ts = uc->uc_tx_stats;
+	RTWN_UNLOCK(sc);
+
+	sbuf_new_for_sysctl(&sb, NULL, 256, req);
+	sbuf_printf(&sb, "%d buffers, %ju qfull, %ju nobufs\nframes:",
+	    RTWN_USB_TX_LIST_COUNT, (uintmax_t)ts.qfull,
+	    (uintmax_t)ts.nobufs);
+	for (i = RTWN_BULK_TX_BE; i < RTWN_N_TRANSFER; i++)
+		sbuf_printf(&sb, " %s %ju", qname[i], (uintmax_t)ts.frames[i]);
+	sbuf_printf(&sb, "\nlatency (us):");
+	for (i = 0; i < RTWN_USB_TX_LAT_NBUCKETS; i++) {
+		if (i < RTWN_USB_TX_LAT_NBUCKETS - 1)
+			sbuf_printf(&sb, " <%d", 250 << i);
+		else
+			sbuf_printf(&sb, " >=%d", 250 << (i - 1));
+		sbuf_printf(&sb, " %ju,", (uintmax_t)ts.lat[i]);
+	}
+	sbuf_printf(&sb, " max %u", ts.lat_max);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
+}
+
+static void
+rtwn_usb_sysctlattach(struct rtwn_usb_softc *uc)
+{
+	struct rtwn_softc *sc = &uc->uc_sc;
+	struct sysctl_ctx_list *ctx = device_get_sysctl_ctx(sc->sc_dev);
+	struct sysctl_oid *tree = device_get_sysctl_tree(sc->sc_dev);
+
+	SYSCTL_ADD_INT(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "usb_stats", CTLFLAG_RWTUN, &uc->uc_stats_enable,
+	    uc->uc_stats_enable, "Enable USB transfer statistics");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "rx_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, uc, 0,
+	    rtwn_usb_sysctl_rx_stats, "A", "Rx aggregate parsing statistics");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+	    "tx_stats", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, uc, 0,
+	    rtwn_usb_sysctl_tx_stats, "A", "Tx buffer usage statistics");
+}
+#endif
+
 static int
 rtwn_usb_attach(device_t self)
 {
@@ -346,6 +438,9 @@ rtwn_usb_attach(device_t self)
 
 	rtwn_usb_attach_methods(sc);
 	rtwn_usb_attach_private(uc, USB_GET_DRIVER_INFO(uaa));
+#ifdef RTWN_DEBUG
+	rtwn_usb_sysctlattach(uc);
+#endif
 
 	error = rtwn_usb_setup_endpoints(uc);
 	if (error != 0)
@@ -387,6 +482,7 @@ rtwn_usb_detach(device_t self)
 
 	/* Detach all USB transfers. */
 	usbd_transfer_unsetup(uc->uc_xfer, RTWN_N_TRANSFER);
+	rtwn_trace_free(sc);
 
 	rtwn_detach_private(sc);
 	mtx_destroy(&sc->sc_mtx);
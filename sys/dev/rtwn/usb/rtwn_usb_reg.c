@@ -30,6 +30,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/malloc.h>
 #include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/taskqueue.h>
 #include <sys/bus.h>
 #include <sys/endian.h>
@@ -46,18 +47,21 @@ __FBSDID("$FreeBSD$");
 
 #include <dev/rtwn/if_rtwnvar.h>
 #include <dev/rtwn/if_rtwn_debug.h>
+#include <dev/rtwn/if_rtwn_stats.h>
+#include <dev/rtwn/if_rtwn_trace.h>
 
 #include <dev/rtwn/usb/rtwn_usb_var.h>
 #include <dev/rtwn/usb/rtwn_usb_reg.h>
 
 static int	rtwn_do_request(struct rtwn_softc *,
 		    struct usb_device_request *, void *);
-static int	rtwn_usb_read_region_1(struct rtwn_softc *,
-		    uint16_t, uint8_t *, int);
 
 /* USB Requests. */
 #define R92C_REQ_REGS		0x05
 
+/* Max. length of a single register read request. */
+#define RTWN_USB_READ_MAXLEN	64
+
 
 static int
 rtwn_do_request(struct rtwn_softc *sc, struct usb_device_request *req,
@@ -65,25 +69,40 @@ rtwn_do_request(struct rtwn_softc *sc, struct usb_device_request *req,
 {
 	struct rtwn_usb_softc *uc = RTWN_USB_SOFTC(sc);
 	usb_error_t err;
-	int ntries = 10;
+	sbintime_t start;
+	int error, ntries = 10;
 
 	RTWN_ASSERT_LOCKED(sc);
 
+	start = sc->sc_regacct_enable ? sbinuptime() : 0;
+	error = EIO;
 	while (ntries--) {
 		err = usbd_do_request_flags(uc->uc_udev, &sc->sc_mtx,
 		    req, data, 0, NULL, 250 /* ms */);
-		if (err == USB_ERR_NORMAL_COMPLETION)
-			return (0);
+		if (err == USB_ERR_NORMAL_COMPLETION) {
+			error = 0;
+			break;
+		}
 
 		RTWN_DPRINTF(sc, RTWN_DEBUG_USB,
 		    "%s: control request failed, %s (retries left: %d)\n",
 		    __func__, usbd_errstr(err), ntries);
-		if (err == USB_ERR_NOT_CONFIGURED)
-			return (ENXIO);
+		if (err == USB_ERR_NOT_CONFIGURED) {
+			error = ENXIO;
+			break;
+		}
 
 		usb_pause_mtx(&sc->sc_mtx, hz / 100);
 	}
-	return (EIO);
+
+	if (start != 0) {
+		rtwn_stats_reg(sc,
+		    req->bmRequestType == UT_WRITE_VENDOR_DEVICE,
+		    UGETW(req->wLength), 9 - MAX(ntries, 0),
+		    sbinuptime() - start);
+	}
+
+	return (error);
 }
 
 /* export for rtwn_fw_write_block() */
@@ -92,6 +111,10 @@ rtwn_usb_write_region_1(struct rtwn_softc *sc, uint16_t addr, uint8_t *buf,
     int len)
 {
 	usb_device_request_t req;
+	uint32_t val = 0;
+
+	memcpy(&val, buf, MIN(len, sizeof(val)));
+	RTWN_TRACE(sc, REG_WRITE, reg__write, addr, le32toh(val), len, 0);
 
 	req.bmRequestType = UT_WRITE_VENDOR_DEVICE;
 	req.bRequest = R92C_REQ_REGS;
@@ -121,18 +144,42 @@ rtwn_usb_write_4(struct rtwn_softc *sc, uint16_t addr, uint32_t val)
 	return (rtwn_usb_write_region_1(sc, addr, (uint8_t *)&val, sizeof(val)));
 }
 
-static int
+/* export for rtwn_write_region() */
+int
+rtwn_usb_write_region(struct rtwn_softc *sc, uint16_t addr,
+    const uint8_t *buf, int len)
+{
+	/* NB: the request is sent from buf, which is not modified. */
+	return (rtwn_usb_write_region_1(sc, addr, __DECONST(uint8_t *, buf),
+	    len));
+}
+
+/* export for rtwn_read_region() */
+int
 rtwn_usb_read_region_1(struct rtwn_softc *sc, uint16_t addr, uint8_t *buf,
     int len)
 {
 	usb_device_request_t req;
-
-	req.bmRequestType = UT_READ_VENDOR_DEVICE;
-	req.bRequest = R92C_REQ_REGS;
-	USETW(req.wValue, addr);
-	USETW(req.wIndex, 0);
-	USETW(req.wLength, len);
-	return (rtwn_do_request(sc, &req, buf));
+	int error, mlen;
+
+	do {
+		mlen = MIN(len, RTWN_USB_READ_MAXLEN);
+
+		req.bmRequestType = UT_READ_VENDOR_DEVICE;
+		req.bRequest = R92C_REQ_REGS;
+		USETW(req.wValue, addr);
+		USETW(req.wIndex, 0);
+		USETW(req.wLength, mlen);
+		error = rtwn_do_request(sc, &req, buf);
+		if (error != 0)
+			return (error);
+
+		addr += mlen;
+		buf += mlen;
+		len -= mlen;
+	} while (len > 0);
+
+	return (0);
 }
 
 uint8_t
@@ -37,9 +37,13 @@ int		rtwn_usb_write_region_1(struct rtwn_softc *, uint16_t,
 int		rtwn_usb_write_1(struct rtwn_softc *, uint16_t, uint8_t);
 int		rtwn_usb_write_2(struct rtwn_softc *, uint16_t, uint16_t);
 int		rtwn_usb_write_4(struct rtwn_softc *, uint16_t, uint32_t);
+int		rtwn_usb_write_region(struct rtwn_softc *, uint16_t,
+		    const uint8_t *, int);
 uint8_t		rtwn_usb_read_1(struct rtwn_softc *, uint16_t);
 uint16_t	rtwn_usb_read_2(struct rtwn_softc *, uint16_t);
 uint32_t	rtwn_usb_read_4(struct rtwn_softc *, uint16_t);
+int		rtwn_usb_read_region_1(struct rtwn_softc *, uint16_t,
+		    uint8_t *, int);
 void		rtwn_usb_delay(struct rtwn_softc *, int);
 
 #endif	/* RTWN_USB_REG_H */
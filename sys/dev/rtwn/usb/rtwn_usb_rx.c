@@ -125,7 +125,7 @@ rtwn_rx_copy_to_mbuf(struct rtwn_softc *sc, struct r92c_rx_stat *stat,
 	memcpy(mtod(m, uint8_t *), (uint8_t *)stat, totlen);
 	m->m_pkthdr.len = m->m_len = totlen;
 
-	if (rtwn_check_frame(sc, m) != 0) {
+	if (rtwn_check_frame(sc, m, stat) != 0) {
 		m_freem(m);
 		goto fail;
 	}
@@ -140,11 +140,24 @@ static struct mbuf *
 rtwn_rxeof(struct rtwn_softc *sc, uint8_t *buf, int len)
 {
 	struct rtwn_usb_softc *uc = RTWN_USB_SOFTC(sc);
+#ifdef RTWN_DEBUG
+	struct rtwn_usb_rx_stats *rs = &uc->uc_rx_stats;
+	sbintime_t start = 0;
+	int nframes = 0;
+#endif
 	struct r92c_rx_stat *stat;
 	struct mbuf *m, *m0 = NULL;
 	uint32_t rxdw0;
 	int totlen, pktlen, infosz;
 
+#ifdef RTWN_DEBUG
+	if (uc->uc_stats_enable) {
+		start = sbinuptime();
+		rs->xfers++;
+		rs->bytes += len;
+	}
+#endif
+
 	/* Process packets. */
 	while (len >= sizeof(*stat)) {
 		stat = (struct r92c_rx_stat *)buf;
@@ -158,8 +171,18 @@ rtwn_rxeof(struct rtwn_softc *sc, uint8_t *buf, int len)
 
 		/* Make sure everything fits in xfer. */
 		totlen = sizeof(*stat) + infosz + pktlen;
-		if (totlen > len)
+		if (__predict_false(totlen > len)) {
+			RTWN_DPRINTF(sc, RTWN_DEBUG_RECV,
+			    "%s: truncated frame (rxdw0 %08X, %d > %d)\n",
+			    __func__, rxdw0, totlen, len);
+#ifdef RTWN_DEBUG
+			rs->truncated++;
+#endif
 			break;
+		}
+#ifdef RTWN_DEBUG
+		nframes++;
+#endif
 
 		if (m0 == NULL)
 			m0 = m = rtwn_rx_copy_to_mbuf(sc, stat, totlen);
@@ -175,6 +198,15 @@ rtwn_rxeof(struct rtwn_softc *sc, uint8_t *buf, int len)
 		len -= totlen;
 	}
 
+#ifdef RTWN_DEBUG
+	if (start != 0) {
+		rs->frames += nframes;
+		if (rs->agg_max < nframes)
+			rs->agg_max = nframes;
+		rs->usec += sbttous(sbinuptime() - start);
+	}
+#endif
+
 	return (m0);
 }
 
@@ -199,7 +231,7 @@ rtwn_report_intr(struct rtwn_usb_softc *uc, struct usb_xfer *xfer,
 	case RTWN_RX_DATA:
 		return (rtwn_rxeof(sc, buf, len));
 	case RTWN_RX_TX_REPORT:
-		if (sc->sc_ratectl != RTWN_RATECTL_NET80211) {
+		if (!RTWN_RATECTL_TXRPT(sc)) {
 			/* shouldn't happen */
 			device_printf(sc->sc_dev,
 			    "%s called while ratectl = %d!\n",
@@ -243,6 +275,46 @@ rtwn_rx_frame(struct rtwn_softc *sc, struct mbuf *m, int8_t *rssi)
 	return (rtwn_rx_common(sc, m, &stat, rssi));
 }
 
+/*
+ * Monitor mode fast path: prepare up to RTWN_USB_RX_MON_BATCH frames
+ * with the lock held, then pass them up with a single unlock.
+ */
+static void
+rtwn_usb_rx_monitor(struct rtwn_softc *sc, struct mbuf *m)
+{
+	struct ieee80211com *ic = &sc->sc_ic;
+	struct rtwn_rx_mon mon[RTWN_USB_RX_MON_BATCH];
+	struct mbuf *batch[RTWN_USB_RX_MON_BATCH];
+	struct r92c_rx_stat stat;
+	uint64_t tsf;
+	int i, n;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	tsf = 0;
+	while (m != NULL) {
+		for (n = 0; m != NULL && n < nitems(batch); n++) {
+			batch[n] = m;
+			m = m->m_next;
+			batch[n]->m_next = NULL;
+
+			/* Imitate PCIe layout. */
+			m_copydata(batch[n], 0, sizeof(stat), (caddr_t)&stat);
+			m_adj(batch[n], sizeof(stat));
+			rtwn_rx_monitor(sc, batch[n], &stat, &mon[n], &tsf);
+		}
+
+		RTWN_UNLOCK(sc);
+		for (i = 0; i < n; i++) {
+			if (ieee80211_radiotap_active(ic))
+				rtwn_rx_monitor_tap(sc, &mon[i]);
+			(void)ieee80211_input_all(ic, batch[i],
+			    mon[i].rssi - RTWN_NOISE_FLOOR, RTWN_NOISE_FLOOR);
+		}
+		RTWN_LOCK(sc);
+	}
+}
+
 void
 rtwn_bulk_rx_callback(struct usb_xfer *xfer, usb_error_t error)
 {
@@ -283,6 +355,10 @@ tr_setup:
 		 * ieee80211_input() because here is at the end of a USB
 		 * callback and safe to unlock.
 		 */
+		if (m != NULL && RTWN_MONITOR_ONLY(sc)) {
+			rtwn_usb_rx_monitor(sc, m);
+			m = NULL;
+		}
 		while (m != NULL) {
 			next = m->m_next;
 			m->m_next = NULL;
@@ -327,7 +403,7 @@ finish:
 	 */
 #ifdef	IEEE80211_SUPPORT_SUPERG
 	if (!(sc->sc_flags & RTWN_FW_LOADED) ||
-	    sc->sc_ratectl != RTWN_RATECTL_NET80211)
+	    !RTWN_RATECTL_TXRPT(sc))
 		rtwn_cmd_sleepable(sc, NULL, 0, rtwn_ff_flush_all);
 #endif
 
@@ -101,6 +101,9 @@ rtwn_usb_getbuf(struct rtwn_usb_softc *uc)
 	if (bf == NULL) {
 		RTWN_DPRINTF(sc, RTWN_DEBUG_XMIT, "%s: stop queue\n",
 		    __func__);
+#ifdef RTWN_DEBUG
+		uc->uc_tx_stats.nobufs++;
+#endif
 	}
 	return (bf);
 }
@@ -109,13 +112,31 @@ static void
 rtwn_usb_txeof(struct rtwn_usb_softc *uc, struct rtwn_data *data, int status)
 {
 	struct rtwn_softc *sc = &uc->uc_sc;
+#ifdef RTWN_DEBUG
+	struct rtwn_usb_tx_stats *ts = &uc->uc_tx_stats;
+	uint32_t lat;
+	int i;
+#endif
 
 	RTWN_ASSERT_LOCKED(sc);
 
+#ifdef RTWN_DEBUG
+	/* Queueing + transfer latency. */
+	if (data->queued != 0) {
+		lat = sbttous(sbinuptime() - data->queued);
+		if (ts->lat_max < lat)
+			ts->lat_max = lat;
+		for (i = 0; i < RTWN_USB_TX_LAT_NBUCKETS - 1; i++)
+			if (lat < (250 << i))
+				break;
+		ts->lat[i]++;
+	}
+#endif
+
 	if (data->ni != NULL)	/* not a beacon frame */
 		ieee80211_tx_complete(data->ni, data->m, status);
 
-	if (sc->sc_ratectl != RTWN_RATECTL_NET80211)
+	if (!RTWN_RATECTL_TXRPT(sc))
 		if (sc->sc_tx_n_active > 0)
 			sc->sc_tx_n_active--;
 
@@ -138,11 +159,18 @@ rtwn_bulk_tx_callback(struct usb_xfer *xfer, usb_error_t error)
 	struct rtwn_usb_softc *uc = usbd_xfer_softc(xfer);
 	struct rtwn_softc *sc = &uc->uc_sc;
 	struct rtwn_data *data;
+	int qid;
 
 	RTWN_ASSERT_LOCKED(sc);
 
+	for (qid = RTWN_BULK_TX_BE; qid < RTWN_N_TRANSFER; qid++)
+		if (uc->uc_xfer[qid] == xfer)
+			break;
+	KASSERT(qid < RTWN_N_TRANSFER, ("unknown Tx xfer"));
+
 	switch (USB_GET_STATE(xfer)){
 	case USB_ST_TRANSFERRED:
+		uc->uc_tx_resets[qid] = 0;
 		data = STAILQ_FIRST(&uc->uc_tx_active);
 		if (data == NULL)
 			goto tr_setup;
@@ -169,7 +197,8 @@ tr_setup:
 			rtwn_switch_bcnq(sc, data->id);
 		usbd_xfer_set_frame_data(xfer, 0, data->buf, data->buflen);
 		usbd_transfer_submit(xfer);
-		if (sc->sc_ratectl != RTWN_RATECTL_NET80211)
+		uc->uc_tx_last[qid] = ticks;
+		if (!RTWN_RATECTL_TXRPT(sc))
 			sc->sc_tx_n_active++;
 		break;
 	default:
@@ -191,7 +220,7 @@ finish:
 	 * threshold, ensure we age fast-frames out so they're
 	 * transmitted.
 	 */
-	if (sc->sc_ratectl != RTWN_RATECTL_NET80211 &&
+	if (!RTWN_RATECTL_TXRPT(sc) &&
 	    sc->sc_tx_n_active <= 1) {
 		/* XXX ew - net80211 should defer this for us! */
 
@@ -214,6 +243,49 @@ finish:
 	rtwn_start(sc);
 }
 
+/*
+ * Restart Tx pipes which did not complete a transfer during 'timo'
+ * ticks.  Returns the number of restarted pipes or -1 if the device
+ * should be restarted instead.
+ */
+int
+rtwn_usb_tx_recover(struct rtwn_softc *sc, int timo)
+{
+	struct rtwn_usb_softc *uc = RTWN_USB_SOFTC(sc);
+	struct usb_xfer *xfer;
+	int qid, nreset;
+
+	RTWN_ASSERT_LOCKED(sc);
+
+	nreset = 0;
+	for (qid = RTWN_BULK_TX_BE; qid < RTWN_N_TRANSFER; qid++) {
+		xfer = uc->uc_xfer[qid];
+		if (!usbd_transfer_pending(xfer) ||
+		    ticks - uc->uc_tx_last[qid] < timo)
+			continue;
+
+		/* Did not help last time. */
+		if (uc->uc_tx_resets[qid] >= RTWN_USB_TX_RESET_MAX)
+			return (-1);
+
+		RTWN_DPRINTF(sc, RTWN_DEBUG_RESET,
+		    "%s: pipe %d: no completion for %d ticks\n", __func__,
+		    qid, ticks - uc->uc_tx_last[qid]);
+
+		/*
+		 * The cancelled transfer is completed with an error;
+		 * the pending queue is resubmitted from scratch.
+		 */
+		usbd_transfer_stop(xfer);
+		usbd_transfer_start(xfer);
+		uc->uc_tx_last[qid] = ticks;
+		uc->uc_tx_resets[qid]++;
+		nreset++;
+	}
+
+	return (nreset);
+}
+
 static void
 rtwn_usb_tx_checksum(struct rtwn_tx_desc_common *txd)
 {
@@ -230,6 +302,7 @@ rtwn_usb_tx_start(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	struct rtwn_data *data;
 	struct usb_xfer *xfer;
 	uint16_t ac;
+	int qid;
 
 	RTWN_ASSERT_LOCKED(sc);
 
@@ -242,12 +315,16 @@ rtwn_usb_tx_start(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	switch (type) {
 	case IEEE80211_FC0_TYPE_CTL:
 	case IEEE80211_FC0_TYPE_MGT:
-		xfer = uc->uc_xfer[RTWN_BULK_TX_VO];
+		qid = RTWN_BULK_TX_VO;
 		break;
 	default:
-		xfer = uc->uc_xfer[wme2qid[ac]];
+		qid = wme2qid[ac];
 		break;
 	}
+	xfer = uc->uc_xfer[qid];
+#ifdef RTWN_DEBUG
+	uc->uc_tx_stats.frames[qid]++;
+#endif
 
 	txd = (struct rtwn_tx_desc_common *)tx_desc;
 	txd->pktlen = htole16(m->m_pkthdr.len);
@@ -263,6 +340,9 @@ rtwn_usb_tx_start(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	    (caddr_t)(data->buf + sc->txdesc_len));
 
 	data->buflen = m->m_pkthdr.len + sc->txdesc_len;
+#ifdef RTWN_DEBUG
+	data->queued = uc->uc_stats_enable ? sbinuptime() : 0;
+#endif
 	data->id = id;
 	data->ni = ni;
 	if (data->ni != NULL) {
@@ -273,8 +353,12 @@ rtwn_usb_tx_start(struct rtwn_softc *sc, struct ieee80211_node *ni,
 	}
 
 	STAILQ_INSERT_TAIL(&uc->uc_tx_pending, data, next);
-	if (STAILQ_EMPTY(&uc->uc_tx_inactive))
+	if (STAILQ_EMPTY(&uc->uc_tx_inactive)) {
 		sc->qfullmsk = 1;
+#ifdef RTWN_DEBUG
+		uc->uc_tx_stats.qfull++;
+#endif
+	}
 
 	usbd_transfer_start(xfer);
 
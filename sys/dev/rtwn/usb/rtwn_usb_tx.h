@@ -20,6 +20,7 @@
 #define RTWN_USB_TX_H
 
 void	rtwn_bulk_tx_callback(struct usb_xfer *, usb_error_t);
+int	rtwn_usb_tx_recover(struct rtwn_softc *, int);
 int	rtwn_usb_tx_start(struct rtwn_softc *, struct ieee80211_node *,
 	    struct mbuf *, uint8_t *, uint8_t, int);
 
@@ -24,6 +24,7 @@
 #define RTWN_IFACE_INDEX		0
 
 #define RTWN_USB_RX_LIST_COUNT		1
+#define RTWN_USB_RX_MON_BATCH		16	/* frames per lock drop */
 #define RTWN_USB_TX_LIST_COUNT		16
 
 struct rtwn_data {
@@ -31,6 +32,9 @@ struct rtwn_data {
 	/* 'id' is meaningful for beacons only */
 	int				id;
 	uint16_t			buflen;
+#ifdef RTWN_DEBUG
+	sbintime_t			queued;		/* 0 - not timed */
+#endif
 	struct mbuf			*m;
 	struct ieee80211_node		*ni;
 	STAILQ_ENTRY(rtwn_data)	next;
@@ -48,6 +52,32 @@ enum {
 
 #define RTWN_EP_QUEUES		RTWN_BULK_RX
 
+#ifdef RTWN_DEBUG
+/* Rx aggregate parsing statistics - under RTWN_LOCK(). */
+struct rtwn_usb_rx_stats {
+	uint64_t		xfers;
+	uint64_t		frames;
+	uint64_t		bytes;
+	uint64_t		truncated;	/* bad PKTLEN / INFOSZ */
+	uint64_t		usec;		/* time spent in rtwn_rxeof() */
+	uint32_t		agg_max;	/* frames per transfer */
+};
+#endif
+
+#define RTWN_USB_TX_RESET_MAX	2	/* per pipe, in a row */
+
+#ifdef RTWN_DEBUG
+/* Tx buffer usage statistics - under RTWN_LOCK(). */
+#define RTWN_USB_TX_LAT_NBUCKETS	8	/* 250us .. 16ms, log2 */
+struct rtwn_usb_tx_stats {
+	uint64_t		frames[RTWN_N_TRANSFER];	/* per xfer */
+	uint64_t		qfull;		/* last buffer was taken */
+	uint64_t		nobufs;		/* no buffer available */
+	uint64_t		lat[RTWN_USB_TX_LAT_NBUCKETS];
+	uint32_t		lat_max;	/* usec */
+};
+#endif
+
 struct rtwn_usb_softc {
 	struct rtwn_softc	uc_sc;		/* must be the first */
 	struct usb_device	*uc_udev;
@@ -62,6 +92,13 @@ struct rtwn_usb_softc {
 	rtwn_datahead		uc_tx_pending;
 
 	int			(*uc_align_rx)(int, int);
+#ifdef RTWN_DEBUG
+	int			uc_stats_enable;
+	struct rtwn_usb_rx_stats uc_rx_stats;
+	struct rtwn_usb_tx_stats uc_tx_stats;
+#endif
+	int			uc_tx_last[RTWN_N_TRANSFER];	/* ticks */
+	int			uc_tx_resets[RTWN_N_TRANSFER];
 
 	int			ntx;
 	int			tx_agg_desc_num;